@@ -30,14 +30,18 @@ fn addEngineSources(b: *std.Build, opts: LibBuildOpts) *std.Build.Module {
             "src/computer.c",
             "src/deviceInfo.c",
             "src/universe.c",
+            "src/scheduler.c",
+            "src/network.c",
             "src/unicode.c",
             // components
             "src/components/eeprom.c",
             "src/components/volatileEeprom.c",
             "src/components/filesystem.c",
             "src/components/volatileFilesystem.c",
+            "src/components/hostFilesystem.c",
             "src/components/drive.c",
             "src/components/volatileDrive.c",
+            "src/components/fileDrive.c",
             "src/components/screen.c",
             "src/components/gpu.c",
             "src/components/keyboard.c",
@@ -15,6 +15,7 @@ nn_componentTable *nn_newComponentTable(nn_Alloc *alloc, const char *typeName, v
     table->constructor = constructor;
     table->destructor = destructor;
     table->methodCount = 0;
+    nn_memset(table->methodIndex, 0, sizeof(table->methodIndex));
     table->alloc = *alloc;
     return table;
 }
@@ -30,6 +31,19 @@ void nn_destroyComponentTable(nn_componentTable *table) {
     nn_dealloc(&alloc, table, sizeof(nn_componentTable));
 }
 
+static nn_size_t nni_findMethod(nn_componentTable *table, const char *methodName, unsigned int hash) {
+    nn_size_t slot = hash % NNI_METHOD_INDEX_SIZE;
+    while(table->methodIndex[slot] != 0) {
+        nn_size_t idx = table->methodIndex[slot] - 1;
+        nn_method_t *method = table->methods + idx;
+        if(method->hash == hash && nn_strcmp(method->name, methodName) == 0) {
+            return idx;
+        }
+        slot = (slot + 1) % NNI_METHOD_INDEX_SIZE;
+    }
+    return NN_METHOD_NONE;
+}
+
 nn_method_t *nn_defineMethod(nn_componentTable *table, const char *methodName, nn_componentMethod *methodFunc, const char *methodDoc) {
     if(table->methodCount == NN_MAX_METHODS) return NULL;
     nn_method_t method;
@@ -44,6 +58,13 @@ nn_method_t *nn_defineMethod(nn_componentTable *table, const char *methodName, n
     }
     method.userdata = NULL;
     method.condition = NULL;
+    method.hash = nn_strhash(methodName);
+    // the first definition wins, same as before we had an index
+    if(nni_findMethod(table, methodName, method.hash) == NN_METHOD_NONE) {
+        nn_size_t slot = method.hash % NNI_METHOD_INDEX_SIZE;
+        while(table->methodIndex[slot] != 0) slot = (slot + 1) % NNI_METHOD_INDEX_SIZE;
+        table->methodIndex[slot] = table->methodCount + 1;
+    }
     table->methods[table->methodCount] = method;
     nn_method_t *ptr = table->methods + table->methodCount;
     table->methodCount++;
@@ -69,13 +90,14 @@ const char *nn_getTableMethod(nn_componentTable *table, nn_size_t idx, nn_bool_t
     return method.name;
 }
 
+nn_size_t nn_findMethod(nn_componentTable *table, const char *methodName) {
+    return nni_findMethod(table, methodName, nn_strhash(methodName));
+}
+
 const char *nn_methodDoc(nn_componentTable *table, const char *methodName) {
-    for(nn_size_t i = 0; i < table->methodCount; i++) {
-        if(nn_strcmp(table->methods[i].name, methodName) == 0) {
-            return table->methods[i].doc;
-        }
-    }
-    return NULL;
+    nn_size_t idx = nn_findMethod(table, methodName);
+    if(idx == NN_METHOD_NONE) return NULL;
+    return table->methods[idx].doc;
 }
 
 static nn_bool_t nni_checkMethodEnabled(nn_method_t method, void *statePtr) {
@@ -85,13 +107,9 @@ static nn_bool_t nni_checkMethodEnabled(nn_method_t method, void *statePtr) {
 
 nn_bool_t nn_isMethodEnabled(nn_component *component, const char *methodName) {
     nn_componentTable *table = component->table;
-    for(nn_size_t i = 0; i < table->methodCount; i++) {
-        if(nn_strcmp(table->methods[i].name, methodName) == 0) {
-            nn_method_t method = table->methods[i];
-            return nni_checkMethodEnabled(method, component->statePtr);
-        }
-    }
-    return false;
+    nn_size_t idx = nn_findMethod(table, methodName);
+    if(idx == NN_METHOD_NONE) return false;
+    return nni_checkMethodEnabled(table->methods[idx], component->statePtr);
 }
 
 nn_computer *nn_getComputerOfComponent(nn_component *component) {
@@ -118,25 +136,24 @@ void *nn_getComponentUserdata(nn_component *component) {
     return component->statePtr;
 }
 
-nn_bool_t nn_invokeComponentMethod(nn_component *component, const char *name) {
+nn_bool_t nn_invokeComponentMethodById(nn_component *component, nn_size_t methodId) {
     nn_componentTable *table = component->table;
-    for(nn_size_t i = 0; i < table->methodCount; i++) {
-        nn_method_t method = table->methods[i];
-        if(nn_strcmp(method.name, name) == 0) {
-			nn_callCost(component->computer, NN_CALL_COST);
-			if(!method.direct) {
-				nn_triggerIndirect(component->computer);
-			}
-			if(!nni_checkMethodEnabled(method, component->statePtr)) {
-				return false; // pretend it's gone
-			}
-            method.method(component->statePtr, method.userdata, component, component->computer);
-            return true;
-        }
+    // no such method
+    if(methodId >= table->methodCount) return false;
+    nn_method_t *method = table->methods + methodId;
+    nn_callCost(component->computer, NN_CALL_COST);
+    if(!method->direct) {
+        nn_triggerIndirect(component->computer);
+    }
+    if(!nni_checkMethodEnabled(*method, component->statePtr)) {
+        return false; // pretend it's gone
     }
+    method->method(component->statePtr, method->userdata, component, component->computer);
+    return true;
+}
 
-    // no such method
-    return false;
+nn_bool_t nn_invokeComponentMethod(nn_component *component, const char *name) {
+    return nn_invokeComponentMethodById(component, nn_findMethod(component->table, name));
 }
 
 void nn_simulateBufferedIndirect(nn_component *component, double amount, double amountPerTick) {
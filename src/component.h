@@ -4,8 +4,12 @@
 #include "neonucleus.h"
 #include "computer.h"
 
+// open addressing, kept at most half full so probes stay short
+#define NNI_METHOD_INDEX_SIZE (NN_MAX_METHODS * 2)
+
 typedef struct nn_method_t {
     char *name;
+    unsigned int hash;
     nn_componentMethod *method;
     void *userdata;
     char *doc;
@@ -21,10 +25,15 @@ typedef struct nn_componentTable {
     nn_componentDestructor *destructor;
     nn_method_t methods[NN_MAX_METHODS];
     nn_size_t methodCount;
+    // method index + 1, 0 means empty
+    unsigned char methodIndex[NNI_METHOD_INDEX_SIZE];
 } nn_componentTable;
 
 typedef struct nn_component {
     nn_address address;
+    unsigned int addressHash;
+    // bumped every time the slot is reused, so stale handles don't resolve
+    nn_size_t generation;
     int slot;
     float indirectBufferProgress;
     nn_componentTable *table;
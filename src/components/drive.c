@@ -47,26 +47,33 @@ nn_bool_t nn_destroyDrive(nn_drive *drive) {
     return true;
 }
 
+void nn_flushDrive(nn_drive *drive) {
+    if(drive->table.flush == NULL) return;
+    nn_lock(&drive->ctx, drive->lock);
+    drive->table.flush(drive->table.userdata);
+    nn_unlock(&drive->ctx, drive->lock);
+}
+
 void nn_drive_destroy(void *_, nn_component *component, nn_drive *drive) {
     nn_destroyDrive(drive);
 }
 
-void nni_drive_readCost(nn_component *component, nn_drive *drive) {
+void nni_drive_readCost(nn_component *component, nn_drive *drive, nn_size_t sectors) {
     nn_driveControl ctrl = drive->ctrl;
     nn_computer *computer = nn_getComputerOfComponent(component);
 
-    nn_simulateBufferedIndirect(component, 1, ctrl.readSectorsPerTick);
-    nn_addHeat(computer, ctrl.readHeatPerSector);
-    nn_removeEnergy(computer, ctrl.readEnergyPerSector);
+    nn_simulateBufferedIndirect(component, sectors, ctrl.readSectorsPerTick);
+    nn_addHeat(computer, ctrl.readHeatPerSector * sectors);
+    nn_removeEnergy(computer, ctrl.readEnergyPerSector * sectors);
 }
 
-void nni_drive_writeCost(nn_component *component, nn_drive *drive) {
+void nni_drive_writeCost(nn_component *component, nn_drive *drive, nn_size_t sectors) {
     nn_driveControl ctrl = drive->ctrl;
     nn_computer *computer = nn_getComputerOfComponent(component);
 
-    nn_simulateBufferedIndirect(component, 1, ctrl.writeSectorsPerTick);
-    nn_addHeat(computer, ctrl.writeHeatPerSector);
-    nn_removeEnergy(computer, ctrl.writeEnergyPerSector);
+    nn_simulateBufferedIndirect(component, sectors, ctrl.writeSectorsPerTick);
+    nn_addHeat(computer, ctrl.writeHeatPerSector * sectors);
+    nn_removeEnergy(computer, ctrl.writeEnergyPerSector * sectors);
 }
 
 void nni_drive_seekTo(nn_component *component, nn_drive *drive, nn_size_t sector) {
@@ -113,6 +120,13 @@ void nni_drive_seekTo(nn_component *component, nn_drive *drive, nn_size_t sector
     nn_removeEnergy(computer, ctrl.motorEnergyPerSector * moved);
 }
 
+// Batches pay for the seek to their first sector, then the head rides along for free.
+// This leaves it on the last one, so the next batch of a sequential scan barely moves.
+void nni_drive_seekPast(nn_drive *drive, nn_size_t sector) {
+    nn_size_t sectorsPerPlatter = (drive->table.capacity / drive->table.sectorSize) / drive->table.platterCount;
+    drive->currentSector = (sector - 1) % sectorsPerPlatter;
+}
+
 void nn_drive_getLabel(nn_drive *drive, void *_, nn_component *component, nn_computer *computer) {
     char buf[NN_LABEL_SIZE];
     nn_size_t l = NN_LABEL_SIZE;
@@ -150,6 +164,95 @@ void nn_drive_getCapacity(nn_drive *drive, void *_, nn_component *component, nn_
     nn_size_t capacity = drive->table.capacity;
     nn_return(computer, nn_values_integer(capacity));
 }
+// bulk helpers, using the table's own bulk callbacks when it has them
+
+static void nni_drive_readSectors(nn_drive *drive, int sector, nn_size_t count, char *buf) {
+    if(drive->table.readSectors != NULL) {
+        drive->table.readSectors(drive->table.userdata, sector, count, buf);
+        return;
+    }
+    nn_size_t sector_size = drive->table.sectorSize;
+    for(nn_size_t i = 0; i < count; i++) {
+        drive->table.readSector(drive->table.userdata, sector + i, buf + i * sector_size);
+    }
+}
+
+// stops at the first sector which fails
+static void nni_drive_writeSectors(nn_drive *drive, int sector, nn_size_t count, const char *buf, nn_errorbuf_t err) {
+    if(drive->table.writeSectors != NULL) {
+        drive->table.writeSectors(drive->table.userdata, sector, count, buf, err);
+        return;
+    }
+    nn_size_t sector_size = drive->table.sectorSize;
+    for(nn_size_t i = 0; i < count && nn_error_isEmpty(err); i++) {
+        drive->table.writeSector(drive->table.userdata, sector + i, buf + i * sector_size, err);
+    }
+}
+
+static void nni_drive_readBytes(nn_drive *drive, nn_size_t offset, nn_size_t len, char *buf) {
+    if(drive->table.readBytes != NULL) {
+        drive->table.readBytes(drive->table.userdata, offset, len, buf);
+        return;
+    }
+    nn_size_t sector_size = drive->table.sectorSize;
+    while(len > 0) {
+        int sector = (offset / sector_size) + 1;
+        nn_size_t sector_offset = offset % sector_size;
+        nn_size_t chunk;
+        if(sector_offset == 0 && len >= sector_size) {
+            // whole sectors go straight into buf
+            nn_size_t count = len / sector_size;
+            nni_drive_readSectors(drive, sector, count, buf);
+            chunk = count * sector_size;
+        } else {
+            char sectorBuf[sector_size];
+            drive->table.readSector(drive->table.userdata, sector, sectorBuf);
+            chunk = sector_size - sector_offset;
+            if(chunk > len) chunk = len;
+            nn_memcpy(buf, sectorBuf + sector_offset, chunk);
+        }
+        offset += chunk;
+        buf += chunk;
+        len -= chunk;
+    }
+}
+
+static void nni_drive_writeBytes(nn_drive *drive, nn_size_t offset, nn_size_t len, const char *buf, nn_errorbuf_t err) {
+    if(drive->table.writeBytes != NULL) {
+        drive->table.writeBytes(drive->table.userdata, offset, len, buf, err);
+        return;
+    }
+    nn_size_t sector_size = drive->table.sectorSize;
+    while(len > 0 && nn_error_isEmpty(err)) {
+        int sector = (offset / sector_size) + 1;
+        nn_size_t sector_offset = offset % sector_size;
+        nn_size_t chunk;
+        if(sector_offset == 0 && len >= sector_size) {
+            nn_size_t count = len / sector_size;
+            nni_drive_writeSectors(drive, sector, count, buf, err);
+            chunk = count * sector_size;
+        } else {
+            // partial sectors have to be read, modified and written back
+            char sectorBuf[sector_size];
+            drive->table.readSector(drive->table.userdata, sector, sectorBuf);
+            chunk = sector_size - sector_offset;
+            if(chunk > len) chunk = len;
+            nn_memcpy(sectorBuf + sector_offset, buf, chunk);
+            drive->table.writeSector(drive->table.userdata, sector, sectorBuf, err);
+        }
+        offset += chunk;
+        buf += chunk;
+        len -= chunk;
+    }
+}
+
+// how many sectors a byte range touches, for the costs
+static nn_size_t nni_drive_sectorsSpanned(nn_drive *drive, nn_size_t offset, nn_size_t len) {
+    if(len == 0) return 0;
+    nn_size_t sector_size = drive->table.sectorSize;
+    return (offset + len - 1) / sector_size - offset / sector_size + 1;
+}
+
 void nn_drive_readSector(nn_drive *drive, void *_, nn_component *component, nn_computer *computer) {
     nn_value sectorValue = nn_getArgument(computer, 0);
     int sector = nn_toInt(sectorValue);
@@ -161,9 +264,11 @@ void nn_drive_readSector(nn_drive *drive, void *_, nn_component *component, nn_c
     }
     char buf[sector_size];
     nn_lock(&drive->ctx, drive->lock);
+    nni_drive_seekTo(component, drive, sector);
     drive->table.readSector(drive->table.userdata, sector, buf);
     nn_unlock(&drive->ctx, drive->lock);
     nn_return_string(computer, buf, sector_size);
+    nni_drive_readCost(component, drive, 1);
 }
 void nn_drive_writeSector(nn_drive *drive, void *_, nn_component *component, nn_computer *computer) {
     nn_value sectorValue = nn_getArgument(computer, 0);
@@ -182,29 +287,121 @@ void nn_drive_writeSector(nn_drive *drive, void *_, nn_component *component, nn_
         nn_setCError(computer, "bad argument #1 (sector out of range)");
         return;
     }
+    nn_errorbuf_t err = "";
     nn_lock(&drive->ctx, drive->lock);
-    drive->table.writeSector(drive->table.userdata, sector, buf);
+    nni_drive_seekTo(component, drive, sector);
+    drive->table.writeSector(drive->table.userdata, sector, buf, err);
     nn_unlock(&drive->ctx, drive->lock);
+    if(!nn_error_isEmpty(err)) {
+        nn_setError(computer, err);
+        return;
+    }
 
     nn_return_boolean(computer, true);
+    nni_drive_writeCost(component, drive, 1);
+}
+void nn_drive_readSectors(nn_drive *drive, void *_, nn_component *component, nn_computer *computer) {
+    nn_integer_t sector = nn_toInt(nn_getArgument(computer, 0));
+    nn_integer_t count = nn_toInt(nn_getArgument(computer, 1));
+    nn_size_t sector_size = drive->table.sectorSize;
+    nn_integer_t sectorCount = drive->table.capacity / sector_size;
+    if (sector < 1 || sector > sectorCount) {
+        nn_setCError(computer, "bad argument #1 (sector out of range)");
+        return;
+    }
+    if (count < 1 || count > sectorCount - sector + 1) {
+        nn_setCError(computer, "bad argument #2 (count out of range)");
+        return;
+    }
+    // read straight into the returned string
+    nn_value data = nn_values_stringBuffer(nn_getCallAllocator(computer), count * sector_size);
+    if(data.tag == NN_VALUE_NIL) {
+        nn_setCError(computer, "out of memory");
+        return;
+    }
+    nn_lock(&drive->ctx, drive->lock);
+    nni_drive_seekTo(component, drive, sector);
+    nni_drive_readSectors(drive, sector, count, data.string->data);
+    nni_drive_seekPast(drive, sector + count - 1);
+    nn_unlock(&drive->ctx, drive->lock);
+    nn_return(computer, data);
+    nni_drive_readCost(component, drive, count);
+}
+void nn_drive_writeSectors(nn_drive *drive, void *_, nn_component *component, nn_computer *computer) {
+    nn_integer_t sector = nn_toInt(nn_getArgument(computer, 0));
+    nn_size_t sector_size = drive->table.sectorSize;
+    nn_integer_t sectorCount = drive->table.capacity / sector_size;
+
+    nn_size_t buf_size = 0;
+    const char *buf = nn_toString(nn_getArgument(computer, 1), &buf_size);
+    if (buf == NULL || buf_size == 0 || buf_size % sector_size != 0) {
+        nn_setCError(computer, "bad argument #2 (expected buffer of a multiple of `sectorSize`)");
+        return;
+    }
+    nn_integer_t count = buf_size / sector_size;
+    if (sector < 1 || count > sectorCount - sector + 1) {
+        nn_setCError(computer, "bad argument #1 (sector out of range)");
+        return;
+    }
+    nn_errorbuf_t err = "";
+    nn_lock(&drive->ctx, drive->lock);
+    nni_drive_seekTo(component, drive, sector);
+    nni_drive_writeSectors(drive, sector, count, buf, err);
+    nni_drive_seekPast(drive, sector + count - 1);
+    nn_unlock(&drive->ctx, drive->lock);
+    if(!nn_error_isEmpty(err)) {
+        nn_setError(computer, err);
+        return;
+    }
+
+    nn_return_boolean(computer, true);
+    nni_drive_writeCost(component, drive, count);
+}
+void nn_drive_readBytes(nn_drive *drive, void *_, nn_component *component, nn_computer *computer) {
+    nn_size_t disk_offset = nn_toInt(nn_getArgument(computer, 0)) - 1;
+    nn_integer_t len = nn_toInt(nn_getArgument(computer, 1));
+    if (disk_offset >= drive->table.capacity) {
+        nn_setCError(computer, "bad argument #1 (index out of range)");
+        return;
+    }
+    if (len < 0) {
+        nn_setCError(computer, "bad argument #2 (length out of range)");
+        return;
+    }
+    // reading past the end just gives you less
+    nn_size_t remaining = drive->table.capacity - disk_offset;
+    nn_size_t byteLen = (nn_size_t)len > remaining ? remaining : (nn_size_t)len;
+    nn_value data = nn_values_stringBuffer(nn_getCallAllocator(computer), byteLen);
+    if(data.tag == NN_VALUE_NIL) {
+        nn_setCError(computer, "out of memory");
+        return;
+    }
+    nn_lock(&drive->ctx, drive->lock);
+    nni_drive_seekTo(component, drive, (disk_offset / drive->table.sectorSize) + 1);
+    nni_drive_readBytes(drive, disk_offset, byteLen, data.string->data);
+    if(byteLen > 0) nni_drive_seekPast(drive, (disk_offset + byteLen - 1) / drive->table.sectorSize + 1);
+    nn_unlock(&drive->ctx, drive->lock);
+    nn_return(computer, data);
+    nni_drive_readCost(component, drive, nni_drive_sectorsSpanned(drive, disk_offset, byteLen));
 }
 void nn_drive_readByte(nn_drive *drive, void *_, nn_component *component, nn_computer *computer) {
     nn_value offsetValue = nn_getArgument(computer, 0);
     nn_size_t disk_offset = nn_toInt(offsetValue) - 1;
     nn_size_t sector_size = drive->table.sectorSize;
     int sector = (disk_offset / sector_size) + 1;
-    nn_size_t sector_offset = disk_offset % sector_size;
 
     if (disk_offset >= drive->table.capacity) {
         nn_setCError(computer, "bad argument #1 (index out of range)");
         return;
     }
-    char buf[sector_size];
+    char byte;
     nn_lock(&drive->ctx, drive->lock);
-    drive->table.readSector(drive->table.userdata, sector, buf);
+    nni_drive_seekTo(component, drive, sector);
+    nni_drive_readBytes(drive, disk_offset, 1, &byte);
     nn_unlock(&drive->ctx, drive->lock);
 
-    nn_return(computer, nn_values_integer(buf[sector_offset]));
+    nn_return(computer, nn_values_integer(byte));
+    nni_drive_readCost(component, drive, 1);
 }
 void nn_drive_writeByte(nn_drive *drive, void *_, nn_component *component, nn_computer *computer) {
     nn_value offsetValue = nn_getArgument(computer, 0);
@@ -213,7 +410,6 @@ void nn_drive_writeByte(nn_drive *drive, void *_, nn_component *component, nn_co
     nn_integer_t write = nn_toInt(writeValue);
     nn_size_t sector_size = drive->table.sectorSize;
     int sector = (disk_offset / sector_size) + 1;
-    nn_size_t sector_offset = disk_offset % sector_size;
 
     if (write < -128 || write > 255) {
         nn_setCError(computer, "bad argument #2 (byte out of range)");
@@ -223,16 +419,19 @@ void nn_drive_writeByte(nn_drive *drive, void *_, nn_component *component, nn_co
         nn_setCError(computer, "bad argument #1 (index out of range)");
         return;
     }
+    char byte = write;
+    nn_errorbuf_t err = "";
     nn_lock(&drive->ctx, drive->lock);
-    char buf[sector_size];
-    drive->table.readSector(drive->table.userdata, sector, buf);
-
-    buf[sector_offset] = write;
-
-    drive->table.writeSector(drive->table.userdata, sector, buf);
+    nni_drive_seekTo(component, drive, sector);
+    nni_drive_writeBytes(drive, disk_offset, 1, &byte, err);
     nn_unlock(&drive->ctx, drive->lock);
+    if(!nn_error_isEmpty(err)) {
+        nn_setError(computer, err);
+        return;
+    }
 
     nn_return_boolean(computer, true);
+    nni_drive_writeCost(component, drive, 1);
 }
 
 void nn_loadDriveTable(nn_universe *universe) {
@@ -246,6 +445,9 @@ void nn_loadDriveTable(nn_universe *universe) {
     nn_defineMethod(driveTable, "getCapacity", (nn_componentMethod *)nn_drive_getCapacity, "getCapacity():number - Returns the total capacity of the drive, in bytes.");
     nn_defineMethod(driveTable, "readSector", (nn_componentMethod *)nn_drive_readSector, "readSector(sector:number):string - Read the current contents of the specified sector.");
     nn_defineMethod(driveTable, "writeSector", (nn_componentMethod *)nn_drive_writeSector, "writeSector(sector:number, value:string) - Write the specified contents to the specified sector.");
+    nn_defineMethod(driveTable, "readSectors", (nn_componentMethod *)nn_drive_readSectors, "readSectors(sector:number, count:number):string - Read count consecutive sectors, starting at the specified one.");
+    nn_defineMethod(driveTable, "writeSectors", (nn_componentMethod *)nn_drive_writeSectors, "writeSectors(sector:number, value:string) - Write consecutive sectors starting at the specified one. The length of value must be a multiple of the sector size.");
+    nn_defineMethod(driveTable, "readBytes", (nn_componentMethod *)nn_drive_readBytes, "readBytes(offset:number, len:number):string - Read up to len bytes starting at the specified offset.");
     nn_defineMethod(driveTable, "readByte", (nn_componentMethod *)nn_drive_readByte, "readByte(offset:number):number - Read a single byte at the specified offset.");
     nn_defineMethod(driveTable, "writeByte", (nn_componentMethod *)nn_drive_writeByte, "writeByte(offset:number, value:number) - Write a single byte to the specified offset.");
 }
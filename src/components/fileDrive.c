@@ -0,0 +1,174 @@
+#include "../neonucleus.h"
+
+// A drive stored in an image file on the host.
+// The image is mapped shared, so reads and writes are plain memcpy()s and the OS writes
+// dirty pages back on its own. A store into a page the disk has no room for is a SIGBUS though,
+// so we only map once posix_fallocate() got us every block. Otherwise we do pread()/pwrite(),
+// which can just report a full disk.
+
+#if !defined(NN_BAREMETAL) && defined(NN_POSIX)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+typedef struct nni_fdrive {
+    nn_Context ctx;
+    int fd;
+    // NULL if we are doing pread()/pwrite()
+    char *map;
+    nn_size_t sectorSize;
+    nn_size_t capacity;
+    char label[NN_LABEL_SIZE];
+    nn_size_t labelLen;
+} nni_fdrive;
+
+// true if the whole image has blocks on the disk
+static nn_bool_t nni_fdrive_reserve(int fd, nn_size_t capacity) {
+#ifdef NN_MACOS
+    // no posix_fallocate()
+    return false;
+#else
+    return posix_fallocate(fd, 0, capacity) == 0;
+#endif
+}
+
+static void nni_fdrive_flush(nni_fdrive *drive) {
+    if(drive->map != NULL) {
+        msync(drive->map, drive->capacity, MS_SYNC);
+    } else {
+        fsync(drive->fd);
+    }
+}
+
+static void nni_fdrive_deinit(nni_fdrive *drive) {
+    // unmapping doesn't lose anything, the page cache still has it
+    if(drive->map != NULL) munmap(drive->map, drive->capacity);
+    close(drive->fd);
+    nn_Alloc a = drive->ctx.allocator;
+    nn_dealloc(&a, drive, sizeof(nni_fdrive));
+}
+
+static void nni_fdrive_getLabel(nni_fdrive *drive, char *buf, nn_size_t *buflen) {
+    nn_memcpy(buf, drive->label, drive->labelLen);
+    *buflen = drive->labelLen;
+}
+
+static nn_size_t nni_fdrive_setLabel(nni_fdrive *drive, const char *buf, nn_size_t buflen) {
+    if(buflen > NN_LABEL_SIZE) buflen = NN_LABEL_SIZE;
+    nn_memcpy(drive->label, buf, buflen);
+    drive->labelLen = buflen;
+    return buflen;
+}
+
+static void nni_fdrive_readBytes(nni_fdrive *drive, nn_size_t offset, nn_size_t len, char *buf) {
+    if(drive->map != NULL) {
+        nn_memcpy(buf, drive->map + offset, len);
+        return;
+    }
+    while(len > 0) {
+        ssize_t n = pread(drive->fd, buf, len, offset);
+        if(n <= 0) {
+            // errors and a shrunk image read as zeroes, the drive interface has no way to fail
+            nn_memset(buf, 0, len);
+            return;
+        }
+        buf += n;
+        offset += n;
+        len -= n;
+    }
+}
+
+static void nni_fdrive_writeBytes(nni_fdrive *drive, nn_size_t offset, nn_size_t len, const char *buf, nn_errorbuf_t err) {
+    if(drive->map != NULL) {
+        nn_memcpy(drive->map + offset, buf, len);
+        return;
+    }
+    while(len > 0) {
+        ssize_t n = pwrite(drive->fd, buf, len, offset);
+        if(n < 0 && errno == EINTR) continue;
+        if(n <= 0) {
+            // a full host disk shouldn't look like a successful write
+            nn_error_write(err, n < 0 ? strerror(errno) : "write failed");
+            return;
+        }
+        buf += n;
+        offset += n;
+        len -= n;
+    }
+}
+
+static void nni_fdrive_readSector(nni_fdrive *drive, int sector, char *buf) {
+    nni_fdrive_readBytes(drive, (sector - 1) * drive->sectorSize, drive->sectorSize, buf);
+}
+
+static void nni_fdrive_writeSector(nni_fdrive *drive, int sector, const char *buf, nn_errorbuf_t err) {
+    nni_fdrive_writeBytes(drive, (sector - 1) * drive->sectorSize, drive->sectorSize, buf, err);
+}
+
+static void nni_fdrive_readSectors(nni_fdrive *drive, int sector, nn_size_t count, char *buf) {
+    nni_fdrive_readBytes(drive, (sector - 1) * drive->sectorSize, count * drive->sectorSize, buf);
+}
+
+static void nni_fdrive_writeSectors(nni_fdrive *drive, int sector, nn_size_t count, const char *buf, nn_errorbuf_t err) {
+    nni_fdrive_writeBytes(drive, (sector - 1) * drive->sectorSize, count * drive->sectorSize, buf, err);
+}
+
+nn_drive *nn_fileDrive(nn_Context *context, nn_fileDriveOptions opts, nn_driveControl control) {
+    nn_Alloc *alloc = &context->allocator;
+
+    int fd = open(opts.path, O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+    if(fd < 0) return NULL;
+    struct stat st;
+    if(fstat(fd, &st) != 0) {
+        close(fd);
+        return NULL;
+    }
+    if((nn_size_t)st.st_size < opts.capacity && ftruncate(fd, opts.capacity) != 0) {
+        close(fd);
+        return NULL;
+    }
+
+    nni_fdrive *drive = nn_alloc(alloc, sizeof(nni_fdrive));
+    if(drive == NULL) {
+        close(fd);
+        return NULL;
+    }
+    drive->ctx = *context;
+    drive->fd = fd;
+    drive->map = NULL;
+    if(opts.capacity > 0 && nni_fdrive_reserve(fd, opts.capacity)) {
+        void *map = mmap(NULL, opts.capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if(map != MAP_FAILED) drive->map = map;
+    }
+    drive->sectorSize = opts.sectorSize;
+    drive->capacity = opts.capacity;
+    if(opts.labelLen > NN_LABEL_SIZE) opts.labelLen = NN_LABEL_SIZE;
+    nn_memcpy(drive->label, opts.label, opts.labelLen);
+    drive->labelLen = opts.labelLen;
+
+    nn_driveTable table = {
+        .userdata = drive,
+        .deinit = (void *)nni_fdrive_deinit,
+        .getLabel = (void *)nni_fdrive_getLabel,
+        .setLabel = (void *)nni_fdrive_setLabel,
+        .readSector = (void *)nni_fdrive_readSector,
+        .writeSector = (void *)nni_fdrive_writeSector,
+        .readSectors = (void *)nni_fdrive_readSectors,
+        .writeSectors = (void *)nni_fdrive_writeSectors,
+        .readBytes = (void *)nni_fdrive_readBytes,
+        .writeBytes = (void *)nni_fdrive_writeBytes,
+        .flush = (void *)nni_fdrive_flush,
+        .sectorSize = opts.sectorSize,
+        .platterCount = opts.platterCount,
+        .capacity = opts.capacity,
+    };
+    nn_drive *d = nn_newDrive(context, table, control);
+    if(d == NULL) nni_fdrive_deinit(drive);
+    return d;
+}
+
+#endif
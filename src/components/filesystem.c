@@ -6,7 +6,9 @@ typedef struct nn_filesystem {
     nn_Context ctx;
     nn_filesystemTable table;
     nn_filesystemControl control;
+    // only used if the table doesn't count it itself
     nn_size_t spaceUsedCache;
+    nn_bool_t spaceUsedCached;
 
     // last due to cache concerns (this struck is massive)
     void *files[NN_MAX_OPEN_FILES];
@@ -24,6 +26,7 @@ nn_filesystem *nn_newFilesystem(nn_Context *context, nn_filesystemTable table, n
     fs->table = table;
     fs->control = control;
     fs->spaceUsedCache = 0;
+    fs->spaceUsedCached = false;
     fs->lock = nn_newGuard(context);
     if(fs->lock == NULL) {
         nn_dealloc(&context->allocator, fs, sizeof(nn_filesystem));
@@ -67,20 +70,38 @@ nn_bool_t nn_destroyFilesystem(nn_filesystem *fs) {
 
 nn_size_t nn_fs_getSpaceUsed(nn_filesystem *fs) {
     nn_lock(&fs->ctx, fs->lock);
-    if(fs->spaceUsedCache != 0) {
+    if(fs->table.spaceUsedIsCounted) {
+        nn_size_t spaceUsed = fs->table.spaceUsed(fs->table.userdata);
+        nn_unlock(&fs->ctx, fs->lock);
+        return spaceUsed;
+    }
+    if(fs->spaceUsedCached) {
         nn_unlock(&fs->ctx, fs->lock);
         return fs->spaceUsedCache;
     }
     nn_size_t spaceUsed = fs->table.spaceUsed(fs->table.userdata);
     fs->spaceUsedCache = spaceUsed;
+    fs->spaceUsedCached = true;
     nn_unlock(&fs->ctx, fs->lock);
     return spaceUsed;
 }
 
 void nn_fs_invalidateSpaceUsed(nn_filesystem *fs) {
     nn_lock(&fs->ctx, fs->lock);
-    fs->spaceUsedCache = 0;
+    fs->spaceUsedCached = false;
+    nn_unlock(&fs->ctx, fs->lock);
+}
+
+nn_size_t nn_getFilesystemSpaceUsed(nn_filesystem *fs) {
+    return nn_fs_getSpaceUsed(fs);
+}
+
+nn_size_t nn_getFilesystemNodesUsed(nn_filesystem *fs) {
+    if(fs->table.nodesUsed == NULL) return 0;
+    nn_lock(&fs->ctx, fs->lock);
+    nn_size_t nodes = fs->table.nodesUsed(fs->table.userdata);
     nn_unlock(&fs->ctx, fs->lock);
+    return nodes;
 }
 
 nn_size_t nn_fs_getSpaceRemaining(nn_filesystem *fs) {
@@ -242,6 +263,7 @@ void nn_fs_remove(nn_filesystem *fs, nn_componentMethod *_, nn_component *compon
     nn_errorbuf_t err = "";
     nn_lock(&fs->ctx, fs->lock);
     nn_size_t removed = fs->table.remove(fs->table.userdata, canonical, err);
+    if(removed > 0) nn_fs_invalidateSpaceUsed(fs);
     nn_unlock(&fs->ctx, fs->lock);
     if(!nn_error_isEmpty(err)) {
         nn_setError(computer, err);
@@ -295,7 +317,7 @@ void nn_fs_rename(nn_filesystem *fs, nn_componentMethod *_, nn_component *compon
         return;
     }
     
-    nn_value toValue = nn_getArgument(computer, 0);
+    nn_value toValue = nn_getArgument(computer, 1);
     const char *to = nn_toCString(toValue);
     if(to == NULL) {
         nn_setCError(computer, "bad path #2 (string expected)");
@@ -485,6 +507,8 @@ void nn_fs_open(nn_filesystem *fs, nn_componentMethod *_, nn_component *componen
         }
     }
     void *file = fs->table.open(fs->table.userdata, canonical, mode, err);
+    // w truncates
+    if(mode[0] == 'w') nn_fs_invalidateSpaceUsed(fs);
     if(!nn_error_isEmpty(err)) {
         if(file != NULL) {
             fs->table.close(fs->table.userdata, file, err);
@@ -591,25 +615,36 @@ void nn_fs_read(nn_filesystem *fs, nn_componentMethod *_, nn_component *componen
         return;
     }
 
-    nn_Alloc *alloc = nn_getAllocator(nn_getUniverse(computer));
-    char *buf = nn_alloc(alloc, byteLen);
-    if(buf == NULL) {
-        nn_unlock(&fs->ctx, fs->lock);
-        nn_setCError(computer, "out of memory");
-        return;
+    // the bytes go straight into the returned string, no scratch buffer
+    nn_Alloc *alloc = nn_getCallAllocator(computer);
+    nn_value data;
+    if(fs->table.readValue != NULL) {
+        data = fs->table.readValue(alloc, fs->table.userdata, file, byteLen, err);
+    } else {
+        data = nn_values_stringBuffer(alloc, byteLen);
+        if(data.tag == NN_VALUE_NIL) {
+            nn_unlock(&fs->ctx, fs->lock);
+            nn_setCError(computer, "out of memory");
+            return;
+        }
+        nn_size_t readLen = fs->table.read(fs->table.userdata, file, data.string->data, byteLen, err);
+        if(readLen == 0) {
+            nn_values_drop(data);
+            data = nn_values_nil();
+        } else if(!nn_values_shrinkString(&data, readLen)) {
+            nn_error_write(err, "out of memory");
+        }
     }
-
-    nn_size_t readLen = fs->table.read(fs->table.userdata, file, buf, byteLen, err);
     nn_unlock(&fs->ctx, fs->lock);
     if(!nn_error_isEmpty(err)) {
+        nn_values_drop(data);
         nn_setError(computer, err);
         return;
     }
-    if(readLen > 0) {
+    if(data.tag != NN_VALUE_NIL) {
         // Nothing read means EoF.
-        nn_return_string(computer, buf, readLen);
+        nn_return(computer, data);
     }
-    nn_dealloc(alloc, buf, byteLen);
 
     nn_fs_readCost(fs, len, component);
 }
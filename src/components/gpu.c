@@ -4,7 +4,7 @@
 typedef struct nni_buffer {
 	int width;
 	int height;
-	nn_scrchr_t *data;
+	nni_cell *data;
 } nni_buffer;
 
 typedef struct nni_gpu {
@@ -35,16 +35,6 @@ nn_scrchr_t nni_gpu_makePixel(nni_gpu *gpu, const char *s) {
     };
 }
 
-nn_bool_t nni_samePixel(nn_scrchr_t a, nn_scrchr_t b) {
-    return
-        a.codepoint == b.codepoint &&
-        a.fg == b.fg &&
-        a.bg == b.bg &&
-        a.isFgPalette == b.isFgPalette &&
-        a.isBgPalette == b.isBgPalette
-        ;
-}
-
 nn_bool_t nni_inBounds(nni_gpu *gpu, int x, int y) {
     if(gpu->currentScreen == NULL) return false;
     return
@@ -66,6 +56,124 @@ nn_size_t nni_vramNeededForScreen(nn_screen *screen) {
 	return nni_vramNeededForSize(w, h);
 }
 
+// Row kernels
+// Both the screen and VRAM buffers are row-major grids of nni_cell, so everything
+// below works on a surface, clips once, then goes row by row.
+
+typedef struct nni_surface {
+	nni_cell *cells;
+	// cells per row in memory
+	int stride;
+	// the usable area
+	int width;
+	int height;
+} nni_surface;
+
+nni_surface nni_screenSurface(nn_screen *screen) {
+	return (nni_surface) {
+		.cells = screen->buffer,
+		.stride = screen->maxWidth,
+		.width = screen->width,
+		.height = screen->height,
+	};
+}
+
+nni_surface nni_bufferSurface(nni_buffer *buffer) {
+	return (nni_surface) {
+		.cells = buffer->data,
+		.stride = buffer->width,
+		.width = buffer->width,
+		.height = buffer->height,
+	};
+}
+
+nn_bool_t nni_sameCell(nni_cell a, nni_cell b) {
+	return a.glyph == b.glyph && a.fg == b.fg && a.bg == b.bg;
+}
+
+// clips a span of len from *d in [0, dlen) and from *s in [0, slen), moving both together.
+// Done in long long so silly sizes from Lua can't overflow.
+nn_bool_t nni_clipSpan(int *d, int dlen, int *s, int slen, int *len) {
+	long long dp = *d, sp = *s, l = *len;
+	if(sp < 0) {
+		l += sp;
+		dp -= sp;
+		sp = 0;
+	}
+	if(dp < 0) {
+		l += dp;
+		sp -= dp;
+		dp = 0;
+	}
+	if(sp + l > slen) l = slen - sp;
+	if(dp + l > dlen) l = dlen - dp;
+	if(l <= 0) return false;
+	*d = dp;
+	*s = sp;
+	*len = l;
+	return true;
+}
+
+// a + b without overflowing, for offsets straight from Lua.
+// Anything past the int range is way off every surface, so clamping doesn't change what gets clipped.
+int nni_offsetClamped(int a, int b) {
+	long long r = (long long)a + b;
+	if(r > 0x7FFFFFFF) return 0x7FFFFFFF;
+	if(r < -0x7FFFFFFF) return -0x7FFFFFFF;
+	return r;
+}
+
+// returns how many cells changed. Clips x, y, w and h to what was actually filled.
+int nni_fillRect(nni_surface *surface, int *x, int *y, int *w, int *h, nni_cell cell) {
+	int sx = *x, sy = *y;
+	if(!nni_clipSpan(x, surface->width, &sx, surface->width, w)) return 0;
+	if(!nni_clipSpan(y, surface->height, &sy, surface->height, h)) return 0;
+
+	int changes = 0;
+	for(int j = 0; j < *h; j++) {
+		nni_cell *row = surface->cells + (nn_size_t)(*y + j) * surface->stride + *x;
+		for(int i = 0; i < *w; i++) {
+			changes += !nni_sameCell(row[i], cell);
+			row[i] = cell;
+		}
+	}
+	return changes;
+}
+
+// copies w*h cells from (sx, sy) in src to (dx, dy) in dst. They can be the same surface, and overlap.
+// Clips everything to both surfaces. Returns how many cells changed, and how many of those were
+// turned into spaces in clears (which are also counted in the return value).
+int nni_copyRect(nni_surface *dst, int *dx, int *dy, nni_surface *src, int sx, int sy, int *w, int *h, int *clears) {
+	*clears = 0;
+	if(!nni_clipSpan(dx, dst->width, &sx, src->width, w)) return 0;
+	if(!nni_clipSpan(dy, dst->height, &sy, src->height, h)) return 0;
+
+	// same trick as memmove, walk backwards if we'd otherwise read what we just wrote
+	nn_bool_t sameRows = dst->cells == src->cells;
+	nn_bool_t upwards = sameRows && *dy > sy;
+	nn_bool_t leftwards = sameRows && *dy == sy && *dx > sx;
+
+	int changes = 0;
+	for(int n = 0; n < *h; n++) {
+		int j = upwards ? *h - 1 - n : n;
+		nni_cell *to = dst->cells + (nn_size_t)(*dy + j) * dst->stride + *dx;
+		nni_cell *from = src->cells + (nn_size_t)(sy + j) * src->stride + sx;
+
+		for(int i = 0; i < *w; i++) {
+			nn_bool_t changed = !nni_sameCell(to[i], from[i]);
+			changes += changed;
+			*clears += changed && (from[i].glyph & NNI_CELL_CODEPOINT) == ' ';
+		}
+
+		if(leftwards) {
+			for(int i = *w - 1; i >= 0; i--) to[i] = from[i];
+		} else {
+			for(int i = 0; i < *w; i++) to[i] = from[i];
+		}
+	}
+	return changes;
+}
+
 // VRAM
 
 nni_buffer *nni_vram_newBuffer(nn_Alloc *alloc, int width, int height) {
@@ -76,25 +184,24 @@ nni_buffer *nni_vram_newBuffer(nn_Alloc *alloc, int width, int height) {
 	}
 	buf->width = width;
 	buf->height = height;
-	buf->data = nn_alloc(alloc, sizeof(nn_scrchr_t) * area);
+	buf->data = nn_alloc(alloc, sizeof(nni_cell) * area);
+	if(buf->data == NULL) {
+		nn_dealloc(alloc, buf, sizeof(nni_buffer));
+		return NULL;
+	}
 	for(int i = 0; i < area; i++) {
-		buf->data[i] = (nn_scrchr_t) {
-			.codepoint = ' ',
+		buf->data[i] = (nni_cell) {
+			.glyph = ' ',
 			.fg = 0xFFFFFF,
 			.bg = 0x000000,
-			.isFgPalette = false,
-			.isBgPalette = false,
 		};
 	}
-	if(buf->data == NULL) {
-		nn_dealloc(alloc, buf, sizeof(nni_buffer));
-	}
 	return buf;
 }
 
 void nni_vram_deinit(nn_Alloc *alloc, nni_buffer *buffer) {
 	int area = buffer->width * buffer->height;
-	nn_dealloc(alloc, buffer->data, sizeof(nn_scrchr_t) * area);
+	nn_dealloc(alloc, buffer->data, sizeof(nni_cell) * area);
 	nn_dealloc(alloc, buffer, sizeof(nni_buffer));
 }
 
@@ -117,12 +224,12 @@ nn_scrchr_t nni_vram_getPixel(nni_buffer *buffer, int x, int y) {
 			.isBgPalette = false,
 		};
 	}
-	return buffer->data[x + y * buffer->width];
+	return nni_unpackCell(buffer->data[x + y * buffer->width]);
 }
 
 void nni_vram_setPixel(nni_buffer *buffer, int x, int y, nn_scrchr_t pixel) {
 	if(!nni_vram_inBounds(buffer, x, y)) return;
-	buffer->data[x + y * buffer->width] = pixel;
+	buffer->data[x + y * buffer->width] = nni_packCell(pixel);
 }
 
 void nni_vram_set(nni_gpu *gpu, int x, int y, const char *s, nn_bool_t vertical) {
@@ -144,52 +251,14 @@ void nni_vram_set(nni_gpu *gpu, int x, int y, const char *s, nn_bool_t vertical)
 }
 
 void nni_vram_fill(nni_gpu *gpu, int x, int y, int w, int h, const char *s) {
-	nni_buffer *buffer = gpu->buffers[gpu->activeBuffer - 1];
-	// DoS mitigation
-	if(x < 0) x = 0;
-	if(y < 0) y = 0;
-	if(w > buffer->width) w = buffer->width - x;
-	if(h > buffer->height) h = buffer->height - y;
-
-	nn_scrchr_t p = nni_gpu_makePixel(gpu, s);
-
-	for(int py = 0; py < h; py++) {
-		for(int px = 0; px < w; px++) {
-			nni_vram_setPixel(buffer, px, py, p);
-		}
-	}
+	nni_surface surface = nni_bufferSurface(gpu->buffers[gpu->activeBuffer - 1]);
+	nni_fillRect(&surface, &x, &y, &w, &h, nni_packCell(nni_gpu_makePixel(gpu, s)));
 }
 
-void nni_vram_copy(nni_gpu *gpu, int x, int y, int w, int h, int tx, int ty, nn_errorbuf_t err) {
-	nni_buffer *buffer = gpu->buffers[gpu->activeBuffer - 1];
-	// DoS mitigation
-	if(x < 0) x = 0;
-	if(y < 0) y = 0;
-	if(w > buffer->width) w = buffer->width - x;
-	if(h > buffer->height) h = buffer->height - y;
-
-	nn_size_t tmpBufSize = sizeof(nn_scrchr_t) * w * h;
-	nn_scrchr_t *tmpBuf = nn_alloc(&gpu->alloc, tmpBufSize);
-	if(tmpBuf == NULL) {
-		nn_error_write(err, "out of memory");
-		return;
-	}
-
-	// copy
-	for(int iy = 0; iy < h; iy++) {
-		for(int ix = 0; ix < w; ix++) {
-			tmpBuf[ix + iy * w] = nni_vram_getPixel(buffer, x, y);
-		}
-	}
-	
-	for(int iy = 0; iy < h; iy++) {
-		for(int ix = 0; ix < w; ix++) {
-			nn_scrchr_t p = tmpBuf[ix + iy * w];
-			nni_vram_setPixel(buffer, x + ix + tx, y + iy + ty, p);
-		}
-	}
-
-	nn_dealloc(&gpu->alloc, tmpBuf, tmpBufSize);
+void nni_vram_copy(nni_gpu *gpu, int x, int y, int w, int h, int tx, int ty) {
+	nni_surface surface = nni_bufferSurface(gpu->buffers[gpu->activeBuffer - 1]);
+	int dx = nni_offsetClamped(x, tx), dy = nni_offsetClamped(y, ty), clears;
+	nni_copyRect(&surface, &dx, &dy, &surface, x, y, &w, &h, &clears);
 }
 
 // GPU stuff
@@ -288,11 +357,10 @@ void nni_gpu_bind(nni_gpu *gpu, void *_, nn_component *component, nn_computer *c
     gpu->currentScreen = screen;
 
     if(reset) {
-        for(nn_size_t i = 0; i < screen->width; i++) {
-            for(nn_size_t j = 0; j < screen->height; j++) {
-                nn_setPixel(screen, i, j, nni_gpu_makePixel(gpu, " "));
-            }
-        }
+        nni_surface surface = nni_screenSurface(screen);
+        int x = 0, y = 0, w = screen->width, h = screen->height;
+        nni_fillRect(&surface, &x, &y, &w, &h, nni_packCell(nni_gpu_makePixel(gpu, " ")));
+        nn_damageScreen(screen, x, y, w, h);
         nn_size_t area = screen->width * screen->height;
         nn_addHeat(computer, gpu->ctrl.heatPerPixelReset * area);
         nn_simulateBufferedIndirect(component, 1, gpu->ctrl.screenFillPerTick);
@@ -492,27 +560,16 @@ void nni_gpu_fill(nni_gpu *gpu, void *_, nn_component *component, nn_computer *c
     nn_size_t startIdx = 0;
     int codepoint = nn_unicode_nextCodepointPermissive(s, &startIdx);
 
-    // prevent DoS
-    if(x < 0) x = 0;
-    if(y < 0) y = 0;
-    if(w > gpu->currentScreen->width - x) w = gpu->currentScreen->width - x;
-    if(h > gpu->currentScreen->height - y) h = gpu->currentScreen->height - y;
-    
     int changes = 0, clears = 0;
 
-    nn_scrchr_t new = nni_gpu_makePixel(gpu, s);
-
-    for(int cx = x; cx < x + w; cx++) {
-        for(int cy = y; cy < y + h; cy++) {
-            nn_scrchr_t old = nn_getPixel(gpu->currentScreen, cx, cy);
-            if(!nni_samePixel(old, new)) {
-                nn_setPixel(gpu->currentScreen, cx, cy, new);
-                if(codepoint == ' ')
-                    clears++;
-                else changes++;
-            }
-        }
+    nni_surface surface = nni_screenSurface(gpu->currentScreen);
+    int changed = nni_fillRect(&surface, &x, &y, &w, &h, nni_packCell(nni_gpu_makePixel(gpu, s)));
+    if(changed > 0) {
+        nn_damageScreen(gpu->currentScreen, x, y, w, h);
     }
+    if(codepoint == ' ')
+        clears = changed;
+    else changes = changed;
 
     nn_addHeat(computer, gpu->ctrl.heatPerPixelChange * changes);
     nn_removeEnergy(computer, gpu->ctrl.energyPerPixelChange * changes);
@@ -534,53 +591,21 @@ void nni_gpu_copy(nni_gpu *gpu, void *_, nn_component *component, nn_computer *c
     int ty = nn_toInt(nn_getArgument(computer, 5));
 
 	if(gpu->activeBuffer != 0) {
-		nn_errorbuf_t err = "";
-		nni_vram_copy(gpu, x, y, w, h, tx, ty, err);
-		if(!nn_error_isEmpty(err)) {
-			nn_setError(computer, err);
-		}
+		nni_vram_copy(gpu, x, y, w, h, tx, ty);
 		return;
 	}
     
 	if(gpu->currentScreen == NULL) return;
 
-    // prevent DoS
-    if(x < 0) x = 0;
-    if(y < 0) y = 0;
-    if(w > gpu->currentScreen->width) w = gpu->currentScreen->width;
-    if(h > gpu->currentScreen->height) y = gpu->currentScreen->height;
-    
     int changes = 0, clears = 0;
 
-    nn_scrchr_t *tmpBuffer = nn_alloc(&gpu->alloc, sizeof(nn_scrchr_t) * w * h);
-    if(tmpBuffer == NULL) {
-        nn_setCError(computer, "out of memory");
-        return;
+    nni_surface surface = nni_screenSurface(gpu->currentScreen);
+    int dx = nni_offsetClamped(x, tx), dy = nni_offsetClamped(y, ty);
+    changes = nni_copyRect(&surface, &dx, &dy, &surface, x, y, &w, &h, &clears);
+    if(changes > 0) {
+        nn_damageScreen(gpu->currentScreen, dx, dy, w, h);
     }
-
-    for(int cx = x; cx < x + w; cx++) {
-        for(int cy = y; cy < y + h; cy++) {
-            int ox = cx - x;
-            int oy = cy - y;
-            nn_scrchr_t src = nn_getPixel(gpu->currentScreen, cx, cy);
-            nn_scrchr_t old = nn_getPixel(gpu->currentScreen, cx + tx, cy + ty);
-            tmpBuffer[ox + oy * w] = src;
-            if(!nni_samePixel(old, src)) {
-                if(src.codepoint == ' ')
-                    clears++;
-                else changes++;
-            }
-        }
-    }
-
-    for(int ox = 0; ox < w; ox++) {
-        for(int oy = 0; oy < h; oy++) {
-            nn_scrchr_t p = tmpBuffer[ox + oy * w];
-            nn_setPixel(gpu->currentScreen, ox + x + tx, oy + y + ty, p);
-        }
-    }
-
-    nn_dealloc(&gpu->alloc, tmpBuffer, sizeof(nn_scrchr_t) * w * h);
+    changes -= clears;
     
     nn_addHeat(computer, gpu->ctrl.heatPerPixelChange * changes);
     nn_removeEnergy(computer, gpu->ctrl.energyPerPixelChange * changes);
@@ -850,17 +875,11 @@ void nni_gpu_bitblt(nni_gpu *gpu, void *_, nn_component *component, nn_computer
 			return;
 		}
 		
-		int w, h;
-		nn_getResolution(gpu->currentScreen, &w, &h);
-
-		if(width > w) width = w;
-		if(height > h) height = h;
-
-		for(int j = 0; j < height; j++) {
-			for(int i = 0; i < width; i++) {
-				nn_scrchr_t src = nni_vram_getPixel(buf, i + fromCol - 1, j + fromRow - 1);
-				nn_setPixel(screen, i + x - 1, j + y - 1, src);
-			}
+		nni_surface to = nni_screenSurface(screen);
+		nni_surface from = nni_bufferSurface(buf);
+		int dx = x - 1, dy = y - 1, clears;
+		if(nni_copyRect(&to, &dx, &dy, &from, fromCol - 1, fromRow - 1, &width, &height, &clears) > 0) {
+			nn_damageScreen(screen, dx, dy, width, height);
 		}
 		return;
 	}
@@ -873,15 +892,10 @@ void nni_gpu_bitblt(nni_gpu *gpu, void *_, nn_component *component, nn_computer
 			return;
 		}
 		
-		if(width > buf->width) width = buf->width;
-		if(height > buf->height) height = buf->height;
-
-		for(int j = 0; j < height; j++) {
-			for(int i = 0; i < width; i++) {
-				nn_scrchr_t src = nn_getPixel(screen, i + fromCol - 1, j + fromRow - 1);
-				nni_vram_setPixel(buf, i + x - 1, j + y - 1, src);
-			}
-		}
+		nni_surface to = nni_bufferSurface(buf);
+		nni_surface from = nni_screenSurface(screen);
+		int dx = x - 1, dy = y - 1, clears;
+		nni_copyRect(&to, &dx, &dy, &from, fromCol - 1, fromRow - 1, &width, &height, &clears);
 		return;
 	}
 	// from buffer to buffer
@@ -897,15 +911,10 @@ void nni_gpu_bitblt(nni_gpu *gpu, void *_, nn_component *component, nn_computer
 			return;
 		}
 		
-		if(width > destBuf->width) width = destBuf->width;
-		if(height > destBuf->height) height = destBuf->height;
-
-		for(int j = 0; j < height; j++) {
-			for(int i = 0; i < width; i++) {
-				nn_scrchr_t src = nni_vram_getPixel(srcBuf, i + fromCol - 1, j + fromRow - 1);
-				nni_vram_setPixel(destBuf, i + x - 1, j + y - 1, src);
-			}
-		}
+		nni_surface to = nni_bufferSurface(destBuf);
+		nni_surface from = nni_bufferSurface(srcBuf);
+		int dx = x - 1, dy = y - 1, clears;
+		nni_copyRect(&to, &dx, &dy, &from, fromCol - 1, fromRow - 1, &width, &height, &clears);
 		return;
 	}
 }
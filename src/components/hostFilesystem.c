@@ -0,0 +1,822 @@
+#include "../neonucleus.h"
+
+// A filesystem backed by a directory on the host.
+// Everything is done relative to an fd of the root directory, so we never build host paths.
+// Read-only opens are mmap()'d and the mappings are kept around after closing, since OpenOS
+// opens the same handful of files over and over. Stat results are cached as well,
+// and dropped whenever we change anything ourselves, or after a second in case the host did.
+
+#if !defined(NN_BAREMETAL) && defined(NN_POSIX)
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// stat cache entries, must be a power of 2
+#define NNI_HOSTFS_STAT_CACHE 128
+// how long, in seconds, a stat result is trusted for
+#define NNI_HOSTFS_STAT_TTL 1.0
+// how many closed files stay open and mapped
+#define NNI_HOSTFS_IDLE_FILES 16
+#define NNI_HOSTFS_FILES (NN_MAX_OPEN_FILES + NNI_HOSTFS_IDLE_FILES)
+
+typedef struct nni_hoststat {
+    // bumped by every change, entries from older generations are dead
+    nn_size_t generation;
+    double when;
+    unsigned int hash;
+    nn_bool_t exists;
+    nn_bool_t isDirectory;
+    nn_size_t size;
+    nn_timestamp_t lastModified;
+    char path[NN_MAX_PATH];
+} nni_hoststat;
+
+// a file opened read-only, shared by every read handle to it
+typedef struct nni_hostfile {
+    unsigned int hash;
+    int fd;
+    // NULL if the file is empty or couldn't be mapped, in which case we pread() instead
+    const char *map;
+    nn_size_t len;
+    nn_timestamp_t lastModified;
+    nn_size_t handleCount;
+    // for evicting the least recently used idle file
+    nn_size_t lastUsed;
+    // no longer matches what is on disk, freed once the last handle closes
+    nn_bool_t stale;
+    char path[NN_MAX_PATH];
+} nni_hostfile;
+
+typedef enum nni_hostmode {
+    NNI_HOSTMODE_READ,
+    NNI_HOSTMODE_WRITE,
+    NNI_HOSTMODE_APPEND,
+} nni_hostmode;
+
+typedef struct nni_hosthandle {
+    nni_hostmode mode;
+    // read handles
+    nni_hostfile *file;
+    // write handles own their fd
+    int fd;
+    nn_size_t size;
+    nn_size_t position;
+} nni_hosthandle;
+
+typedef struct nni_hostfs {
+    nn_Context ctx;
+    nn_hostFilesystemOptions opts;
+    char *root;
+    int rootFd;
+    // computed on the first spaceUsed(), then kept up to date
+    nn_bool_t counted;
+    nn_size_t bytesUsed;
+    nn_size_t nodesUsed;
+    nn_size_t statGeneration;
+    nn_size_t fileClock;
+    nni_hostfile *files[NNI_HOSTFS_FILES];
+    nni_hoststat stats[NNI_HOSTFS_STAT_CACHE];
+} nni_hostfs;
+
+static const char *nni_hostfs_rel(const char *path) {
+    // the canonical root is the empty string
+    return path[0] == 0 ? "." : path;
+}
+
+static double nni_hostfs_now(nni_hostfs *fs) {
+    nn_Clock c = fs->ctx.clock;
+    return c.proc(c.userdata);
+}
+
+static void nni_hostfs_errno(nn_errorbuf_t err) {
+    if(errno == ENOENT) {
+        nn_error_write(err, "No such file");
+        return;
+    }
+    nn_error_write(err, strerror(errno));
+}
+
+// stat cache
+
+static void nni_hostfs_changed(nni_hostfs *fs) {
+    fs->statGeneration++;
+}
+
+static nni_hoststat *nni_hostfs_stat(nni_hostfs *fs, const char *path) {
+    unsigned int hash = nn_strhash(path);
+    nni_hoststat *entry = &fs->stats[hash & (NNI_HOSTFS_STAT_CACHE - 1)];
+    double now = nni_hostfs_now(fs);
+    if(entry->generation == fs->statGeneration && entry->hash == hash && now - entry->when < NNI_HOSTFS_STAT_TTL && nn_strcmp(entry->path, path) == 0) {
+        return entry;
+    }
+
+    struct stat st;
+    entry->generation = fs->statGeneration;
+    entry->when = now;
+    entry->hash = hash;
+    nn_strcpy(entry->path, path);
+    if(fstatat(fs->rootFd, nni_hostfs_rel(path), &st, 0) != 0) {
+        entry->exists = false;
+        entry->isDirectory = false;
+        entry->size = 0;
+        entry->lastModified = 0;
+        return entry;
+    }
+    entry->exists = true;
+    entry->isDirectory = S_ISDIR(st.st_mode);
+    entry->size = entry->isDirectory ? 0 : st.st_size;
+    entry->lastModified = (nn_timestamp_t)st.st_mtime * 1000;
+    return entry;
+}
+
+// file cache
+
+static void nni_hostfs_freeFile(nni_hostfs *fs, nni_hostfile *file) {
+    if(file->map != NULL) munmap((void *)file->map, file->len);
+    close(file->fd);
+    nn_dealloc(&fs->ctx.allocator, file, sizeof(nni_hostfile));
+}
+
+// idle copies are closed, busy ones are left to their handles
+static void nni_hostfs_dropFile(nni_hostfs *fs, nn_size_t slot) {
+    nni_hostfile *file = fs->files[slot];
+    fs->files[slot] = NULL;
+    if(file->handleCount == 0) {
+        nni_hostfs_freeFile(fs, file);
+    } else {
+        file->stale = true;
+    }
+}
+
+// path NULL drops everything, for when whole trees move around
+static void nni_hostfs_invalidateFiles(nni_hostfs *fs, const char *path) {
+    unsigned int hash = path == NULL ? 0 : nn_strhash(path);
+    for(nn_size_t i = 0; i < NNI_HOSTFS_FILES; i++) {
+        nni_hostfile *file = fs->files[i];
+        if(file == NULL) continue;
+        if(path != NULL && (file->hash != hash || nn_strcmp(file->path, path) != 0)) continue;
+        nni_hostfs_dropFile(fs, i);
+    }
+}
+
+static nni_hostfile *nni_hostfs_openFile(nni_hostfs *fs, const char *path, nn_errorbuf_t err) {
+    unsigned int hash = nn_strhash(path);
+    nn_size_t freeSlot = NNI_HOSTFS_FILES;
+    nn_size_t idleCount = 0;
+    nn_size_t oldestIdle = NNI_HOSTFS_FILES;
+    for(nn_size_t i = 0; i < NNI_HOSTFS_FILES; i++) {
+        nni_hostfile *file = fs->files[i];
+        if(file == NULL) {
+            if(freeSlot == NNI_HOSTFS_FILES) freeSlot = i;
+            continue;
+        }
+        if(file->hash == hash && nn_strcmp(file->path, path) == 0) {
+            // the host may have changed it, which the stat cache notices within a second
+            nni_hoststat *st = nni_hostfs_stat(fs, path);
+            if(st->size == file->len && st->lastModified == file->lastModified) {
+                file->lastUsed = ++fs->fileClock;
+                return file;
+            }
+            nni_hostfs_dropFile(fs, i);
+            if(freeSlot == NNI_HOSTFS_FILES) freeSlot = i;
+            continue;
+        }
+        if(file->handleCount == 0) {
+            idleCount++;
+            if(oldestIdle == NNI_HOSTFS_FILES || file->lastUsed < fs->files[oldestIdle]->lastUsed) oldestIdle = i;
+        }
+    }
+    if(idleCount >= NNI_HOSTFS_IDLE_FILES || freeSlot == NNI_HOSTFS_FILES) {
+        // there's always an idle one, since the component can't hold more than NN_MAX_OPEN_FILES
+        if(oldestIdle == NNI_HOSTFS_FILES) {
+            nn_error_write(err, "too many open files");
+            return NULL;
+        }
+        nni_hostfs_dropFile(fs, oldestIdle);
+        freeSlot = oldestIdle;
+    }
+
+    int fd = openat(fs->rootFd, path, O_RDONLY | O_CLOEXEC);
+    if(fd < 0) {
+        nni_hostfs_errno(err);
+        return NULL;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0) {
+        nni_hostfs_errno(err);
+        close(fd);
+        return NULL;
+    }
+    if(S_ISDIR(st.st_mode)) {
+        nn_error_write(err, "Is a directory");
+        close(fd);
+        return NULL;
+    }
+    nni_hostfile *file = nn_alloc(&fs->ctx.allocator, sizeof(nni_hostfile));
+    if(file == NULL) {
+        nn_error_write(err, "Out of memory");
+        close(fd);
+        return NULL;
+    }
+    file->hash = hash;
+    file->fd = fd;
+    file->len = st.st_size;
+    file->lastModified = (nn_timestamp_t)st.st_mtime * 1000;
+    file->map = NULL;
+    if(file->len > 0) {
+        void *map = mmap(NULL, file->len, PROT_READ, MAP_PRIVATE, fd, 0);
+        // pipes and friends can't be mapped, those just get pread()
+        if(map != MAP_FAILED) file->map = map;
+    }
+    file->handleCount = 0;
+    file->lastUsed = ++fs->fileClock;
+    file->stale = false;
+    nn_strcpy(file->path, path);
+    fs->files[freeSlot] = file;
+    return file;
+}
+
+// space accounting
+
+static void nni_hostfs_countTree(int dirFd, nn_size_t *bytes, nn_size_t *nodes) {
+    DIR *dir = fdopendir(dirFd);
+    if(dir == NULL) {
+        close(dirFd);
+        return;
+    }
+    struct dirent *ent;
+    while((ent = readdir(dir)) != NULL) {
+        if(nn_strcmp(ent->d_name, ".") == 0 || nn_strcmp(ent->d_name, "..") == 0) continue;
+        struct stat st;
+        if(fstatat(dirfd(dir), ent->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0) continue;
+        (*nodes)++;
+        if(S_ISDIR(st.st_mode)) {
+            int sub = openat(dirfd(dir), ent->d_name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if(sub >= 0) nni_hostfs_countTree(sub, bytes, nodes);
+        } else {
+            *bytes += st.st_size;
+        }
+    }
+    closedir(dir);
+}
+
+static void nni_hostfs_ensureCounted(nni_hostfs *fs) {
+    if(fs->counted) return;
+    fs->bytesUsed = 0;
+    fs->nodesUsed = 0;
+    int dirFd = openat(fs->rootFd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(dirFd >= 0) nni_hostfs_countTree(dirFd, &fs->bytesUsed, &fs->nodesUsed);
+    fs->counted = true;
+}
+
+static void nni_hostfs_addBytes(nni_hostfs *fs, nn_size_t added, nn_size_t removed) {
+    if(!fs->counted) return;
+    fs->bytesUsed += added;
+    if(removed > fs->bytesUsed) removed = fs->bytesUsed;
+    fs->bytesUsed -= removed;
+}
+
+static void nni_hostfs_addNodes(nni_hostfs *fs, nn_size_t added, nn_size_t removed) {
+    if(!fs->counted) return;
+    fs->nodesUsed += added;
+    if(removed > fs->nodesUsed) removed = fs->nodesUsed;
+    fs->nodesUsed -= removed;
+}
+
+// the table
+
+void nn_hostfs_deinit(nni_hostfs *fs) {
+    for(nn_size_t i = 0; i < NNI_HOSTFS_FILES; i++) {
+        // handles are all closed by now
+        if(fs->files[i] != NULL) nni_hostfs_freeFile(fs, fs->files[i]);
+    }
+    close(fs->rootFd);
+    nn_Alloc alloc = fs->ctx.allocator;
+    nn_deallocStr(&alloc, fs->root);
+    nn_dealloc(&alloc, fs, sizeof(nni_hostfs));
+}
+
+void nn_hostfs_getLabel(nni_hostfs *fs, char *buf, nn_size_t *buflen, nn_errorbuf_t err) {
+    *buflen = fs->opts.labelLen;
+    nn_memcpy(buf, fs->opts.label, fs->opts.labelLen);
+}
+
+nn_size_t nn_hostfs_setLabel(nni_hostfs *fs, const char *buf, nn_size_t buflen, nn_errorbuf_t err) {
+    if(buflen > NN_LABEL_SIZE) buflen = NN_LABEL_SIZE;
+    nn_memcpy(fs->opts.label, buf, buflen);
+    fs->opts.labelLen = buflen;
+    return buflen;
+}
+
+nn_size_t nn_hostfs_spaceUsed(nni_hostfs *fs) {
+    nni_hostfs_ensureCounted(fs);
+    return fs->bytesUsed;
+}
+
+nn_size_t nn_hostfs_nodesUsed(nni_hostfs *fs) {
+    nni_hostfs_ensureCounted(fs);
+    return fs->nodesUsed;
+}
+
+nn_bool_t nn_hostfs_isReadOnly(nni_hostfs *fs, nn_errorbuf_t err) {
+    return fs->opts.isReadOnly;
+}
+
+nn_size_t nn_hostfs_size(nni_hostfs *fs, const char *path, nn_errorbuf_t err) {
+    nni_hoststat *st = nni_hostfs_stat(fs, path);
+    if(!st->exists) {
+        nn_error_write(err, "No such file");
+        return 0;
+    }
+    return st->size;
+}
+
+static nn_size_t nni_hostfs_removeAt(nni_hostfs *fs, int parentFd, const char *name, nn_errorbuf_t err) {
+    struct stat st;
+    if(fstatat(parentFd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+        nni_hostfs_errno(err);
+        return 0;
+    }
+    if(!S_ISDIR(st.st_mode)) {
+        if(unlinkat(parentFd, name, 0) != 0) {
+            nni_hostfs_errno(err);
+            return 0;
+        }
+        nni_hostfs_addBytes(fs, 0, st.st_size);
+        nni_hostfs_addNodes(fs, 0, 1);
+        return 1;
+    }
+
+    int dirFd = openat(parentFd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if(dirFd < 0) {
+        nni_hostfs_errno(err);
+        return 0;
+    }
+    DIR *dir = fdopendir(dirFd);
+    if(dir == NULL) {
+        nni_hostfs_errno(err);
+        close(dirFd);
+        return 0;
+    }
+    nn_size_t removed = 0;
+    struct dirent *ent;
+    while((ent = readdir(dir)) != NULL) {
+        if(nn_strcmp(ent->d_name, ".") == 0 || nn_strcmp(ent->d_name, "..") == 0) continue;
+        removed += nni_hostfs_removeAt(fs, dirfd(dir), ent->d_name, err);
+        if(!nn_error_isEmpty(err)) break;
+    }
+    closedir(dir);
+    if(!nn_error_isEmpty(err)) return removed;
+    if(unlinkat(parentFd, name, AT_REMOVEDIR) != 0) {
+        nni_hostfs_errno(err);
+        return removed;
+    }
+    nni_hostfs_addNodes(fs, 0, 1);
+    return removed + 1;
+}
+
+nn_size_t nn_hostfs_remove(nni_hostfs *fs, const char *path, nn_errorbuf_t err) {
+    if(fs->opts.isReadOnly) {
+        nn_error_write(err, "readonly");
+        return 0;
+    }
+    if(path[0] == 0) {
+        nn_error_write(err, "Unable to delete root");
+        return 0;
+    }
+    nn_size_t removed = nni_hostfs_removeAt(fs, fs->rootFd, path, err);
+    nni_hostfs_changed(fs);
+    // open handles keep their mappings, the files just stop being found
+    nni_hostfs_invalidateFiles(fs, NULL);
+    return removed;
+}
+
+nn_timestamp_t nn_hostfs_lastModified(nni_hostfs *fs, const char *path, nn_errorbuf_t err) {
+    nni_hoststat *st = nni_hostfs_stat(fs, path);
+    if(!st->exists) {
+        nn_error_write(err, "No such file");
+        return 0;
+    }
+    return st->lastModified;
+}
+
+nn_size_t nn_hostfs_rename(nni_hostfs *fs, const char *from, const char *to, nn_errorbuf_t err) {
+    if(fs->opts.isReadOnly) {
+        nn_error_write(err, "readonly");
+        return 0;
+    }
+    if(from[0] == 0) {
+        nn_error_write(err, "Unable to move root");
+        return 0;
+    }
+    nn_size_t moved = 1;
+    nni_hoststat *st = nni_hostfs_stat(fs, from);
+    if(st->isDirectory) {
+        // only needed for the cost, but the component does charge per file
+        nn_size_t bytes = 0;
+        int dirFd = openat(fs->rootFd, from, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if(dirFd >= 0) nni_hostfs_countTree(dirFd, &bytes, &moved);
+    }
+    if(renameat(fs->rootFd, from, fs->rootFd, to) != 0) {
+        nni_hostfs_errno(err);
+        return 0;
+    }
+    nni_hostfs_changed(fs);
+    nni_hostfs_invalidateFiles(fs, NULL);
+    return moved;
+}
+
+nn_bool_t nn_hostfs_exists(nni_hostfs *fs, const char *path, nn_errorbuf_t err) {
+    return nni_hostfs_stat(fs, path)->exists;
+}
+
+nn_bool_t nn_hostfs_isDirectory(nni_hostfs *fs, const char *path, nn_errorbuf_t err) {
+    nni_hoststat *st = nni_hostfs_stat(fs, path);
+    if(!st->exists) {
+        nn_error_write(err, "No such file");
+        return false;
+    }
+    return st->isDirectory;
+}
+
+nn_bool_t nn_hostfs_makeDirectory(nni_hostfs *fs, const char *path, nn_errorbuf_t err) {
+    if(fs->opts.isReadOnly) {
+        nn_error_write(err, "readonly");
+        return false;
+    }
+    // mkdir -p, walking the canonical path in place
+    char partial[NN_MAX_PATH];
+    nn_size_t i = 0;
+    while(true) {
+        while(path[i] != '/' && path[i] != 0) {
+            partial[i] = path[i];
+            i++;
+        }
+        partial[i] = 0;
+        if(i > 0) {
+            if(mkdirat(fs->rootFd, partial, 0777) == 0) {
+                nni_hostfs_addNodes(fs, 1, 0);
+                nni_hostfs_changed(fs);
+            } else if(errno != EEXIST) {
+                nni_hostfs_errno(err);
+                return false;
+            }
+        }
+        if(path[i] == 0) break;
+        partial[i] = '/';
+        i++;
+    }
+    nni_hoststat *st = nni_hostfs_stat(fs, path);
+    if(!st->isDirectory) {
+        nn_error_write(err, "Is a file");
+        return false;
+    }
+    return true;
+}
+
+char **nn_hostfs_list(nn_Alloc *alloc, nni_hostfs *fs, const char *path, nn_size_t *len, nn_errorbuf_t err) {
+    int dirFd = openat(fs->rootFd, nni_hostfs_rel(path), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(dirFd < 0) {
+        if(errno == ENOTDIR) {
+            nn_error_write(err, "Not a directory");
+        } else {
+            nni_hostfs_errno(err);
+        }
+        return NULL;
+    }
+    DIR *dir = fdopendir(dirFd);
+    if(dir == NULL) {
+        nni_hostfs_errno(err);
+        close(dirFd);
+        return NULL;
+    }
+
+    // entries are taken as readdir() gives them, d_type saves us a stat per entry
+    nn_size_t count = 0;
+    nn_size_t cap = 16;
+    char **buf = nn_alloc(alloc, sizeof(char *) * cap);
+    nn_bool_t oom = buf == NULL;
+    struct dirent *ent;
+    while(!oom && (ent = readdir(dir)) != NULL) {
+        if(nn_strcmp(ent->d_name, ".") == 0 || nn_strcmp(ent->d_name, "..") == 0) continue;
+        nn_bool_t isDirectory = ent->d_type == DT_DIR;
+        if(ent->d_type == DT_UNKNOWN || ent->d_type == DT_LNK) {
+            struct stat st;
+            isDirectory = fstatat(dirfd(dir), ent->d_name, &st, 0) == 0 && S_ISDIR(st.st_mode);
+        }
+        if(count == cap) {
+            char **newBuf = nn_resize(alloc, buf, sizeof(char *) * cap, sizeof(char *) * cap * 2);
+            if(newBuf == NULL) {
+                oom = true;
+                break;
+            }
+            buf = newBuf;
+            cap *= 2;
+        }
+        nn_size_t l = nn_strlen(ent->d_name);
+        char *s = nn_alloc(alloc, l + 2);
+        if(s == NULL) {
+            oom = true;
+            break;
+        }
+        nn_memcpy(s, ent->d_name, l);
+        if(isDirectory) s[l++] = '/';
+        s[l] = 0;
+        buf[count++] = s;
+    }
+    closedir(dir);
+
+    // the caller frees exactly count entries, so trim it down
+    char **exact = NULL;
+    if(!oom) {
+        exact = nn_resize(alloc, buf, sizeof(char *) * cap, sizeof(char *) * count);
+        oom = exact == NULL;
+    }
+    if(oom) {
+        if(buf != NULL) {
+            for(nn_size_t i = 0; i < count; i++) {
+                nn_deallocStr(alloc, buf[i]);
+            }
+            nn_dealloc(alloc, buf, sizeof(char *) * cap);
+        }
+        nn_error_write(err, "Out of memory");
+        return NULL;
+    }
+    *len = count;
+    return exact;
+}
+
+nni_hosthandle *nn_hostfs_open(nni_hostfs *fs, const char *path, const char *mode, nn_errorbuf_t err) {
+    char m = mode[0];
+    nni_hostmode hmode = NNI_HOSTMODE_READ;
+    if(m == 'w') hmode = NNI_HOSTMODE_WRITE;
+    if(m == 'a') hmode = NNI_HOSTMODE_APPEND;
+
+    if(fs->opts.isReadOnly && hmode != NNI_HOSTMODE_READ) {
+        nn_error_write(err, "readonly");
+        return NULL;
+    }
+    if(path[0] == 0) {
+        nn_error_write(err, "Is a directory");
+        return NULL;
+    }
+
+    nni_hosthandle *handle = nn_alloc(&fs->ctx.allocator, sizeof(nni_hosthandle));
+    if(handle == NULL) {
+        nn_error_write(err, "Out of memory");
+        return NULL;
+    }
+    handle->mode = hmode;
+    handle->file = NULL;
+    handle->fd = -1;
+    handle->position = 0;
+
+    if(hmode == NNI_HOSTMODE_READ) {
+        nni_hostfile *file = nni_hostfs_openFile(fs, path, err);
+        if(file == NULL) {
+            nn_dealloc(&fs->ctx.allocator, handle, sizeof(nni_hosthandle));
+            return NULL;
+        }
+        file->handleCount++;
+        handle->file = file;
+        handle->size = file->len;
+        return handle;
+    }
+
+    nni_hoststat *st = nni_hostfs_stat(fs, path);
+    if(st->isDirectory) {
+        nn_dealloc(&fs->ctx.allocator, handle, sizeof(nni_hosthandle));
+        nn_error_write(err, "Is a directory");
+        return NULL;
+    }
+    nn_bool_t existed = st->exists;
+    nn_size_t oldSize = st->size;
+    int flags = O_RDWR | O_CREAT | O_CLOEXEC;
+    if(hmode == NNI_HOSTMODE_WRITE) {
+        // truncating a file someone has mapped would SIGBUS them,
+        // so we give the path a new file and let them keep the old one
+        unsigned int hash = nn_strhash(path);
+        for(nn_size_t i = 0; i < NNI_HOSTFS_FILES; i++) {
+            nni_hostfile *file = fs->files[i];
+            if(file == NULL || file->handleCount == 0) continue;
+            if(file->hash == hash && nn_strcmp(file->path, path) == 0) {
+                unlinkat(fs->rootFd, path, 0);
+                break;
+            }
+        }
+        flags |= O_TRUNC;
+    }
+    nni_hostfs_invalidateFiles(fs, path);
+    nni_hostfs_changed(fs);
+    handle->fd = openat(fs->rootFd, path, flags, 0666);
+    if(handle->fd < 0) {
+        if(errno == ENOENT) {
+            nn_error_write(err, "Missing parent directory");
+        } else {
+            nni_hostfs_errno(err);
+        }
+        nn_dealloc(&fs->ctx.allocator, handle, sizeof(nni_hosthandle));
+        return NULL;
+    }
+    if(!existed) nni_hostfs_addNodes(fs, 1, 0);
+    if(hmode == NNI_HOSTMODE_WRITE) {
+        nni_hostfs_addBytes(fs, 0, oldSize);
+        handle->size = 0;
+    } else {
+        handle->size = oldSize;
+        handle->position = oldSize;
+    }
+    return handle;
+}
+
+nn_bool_t nn_hostfs_close(nni_hostfs *fs, nni_hosthandle *handle, nn_errorbuf_t err) {
+    if(handle->file != NULL) {
+        nni_hostfile *file = handle->file;
+        file->handleCount--;
+        if(file->handleCount == 0 && file->stale) nni_hostfs_freeFile(fs, file);
+    } else {
+        close(handle->fd);
+        nni_hostfs_changed(fs);
+    }
+    nn_dealloc(&fs->ctx.allocator, handle, sizeof(nni_hosthandle));
+    return true;
+}
+
+nn_bool_t nn_hostfs_write(nni_hostfs *fs, nni_hosthandle *handle, const char *buf, nn_size_t len, nn_errorbuf_t err) {
+    if(handle->mode == NNI_HOSTMODE_READ) {
+        nn_error_write(err, "Bad file descriptor");
+        return false;
+    }
+    nn_size_t written = 0;
+    while(written < len) {
+        ssize_t n = pwrite(handle->fd, buf + written, len - written, handle->position + written);
+        if(n < 0) {
+            if(errno == EINTR) continue;
+            nni_hostfs_errno(err);
+            break;
+        }
+        written += n;
+    }
+    handle->position += written;
+    if(handle->position > handle->size) {
+        nni_hostfs_addBytes(fs, handle->position - handle->size, 0);
+        handle->size = handle->position;
+    }
+    nni_hostfs_changed(fs);
+    return written == len;
+}
+
+// how much of the read we can actually do
+static nn_size_t nni_hostfs_readable(nni_hosthandle *handle, nn_size_t required) {
+    if(handle->position >= handle->size) return 0;
+    nn_size_t remaining = handle->size - handle->position;
+    return required > remaining ? remaining : required;
+}
+
+static nn_size_t nni_hostfs_pread(int fd, char *buf, nn_size_t len, nn_size_t offset, nn_errorbuf_t err) {
+    nn_size_t done = 0;
+    while(done < len) {
+        ssize_t n = pread(fd, buf + done, len - done, offset + done);
+        if(n < 0) {
+            if(errno == EINTR) continue;
+            nni_hostfs_errno(err);
+            break;
+        }
+        if(n == 0) break;
+        done += n;
+    }
+    return done;
+}
+
+nn_size_t nn_hostfs_read(nni_hostfs *fs, nni_hosthandle *handle, char *buf, nn_size_t required, nn_errorbuf_t err) {
+    required = nni_hostfs_readable(handle, required);
+    if(required == 0) return 0;
+    if(handle->file != NULL && handle->file->map != NULL) {
+        nn_memcpy(buf, handle->file->map + handle->position, required);
+    } else {
+        int fd = handle->file != NULL ? handle->file->fd : handle->fd;
+        required = nni_hostfs_pread(fd, buf, required, handle->position, err);
+    }
+    handle->position += required;
+    return required;
+}
+
+nn_value nn_hostfs_readValue(nn_Alloc *alloc, nni_hostfs *fs, nni_hosthandle *handle, nn_size_t required, nn_errorbuf_t err) {
+    required = nni_hostfs_readable(handle, required);
+    if(required == 0) return nn_values_nil();
+    if(handle->file != NULL && handle->file->map != NULL) {
+        // straight from the page cache into the string
+        nn_value val = nn_values_string(alloc, handle->file->map + handle->position, required);
+        if(val.tag == NN_VALUE_NIL) {
+            nn_error_write(err, "Out of memory");
+            return val;
+        }
+        handle->position += required;
+        return val;
+    }
+    nn_value val = nn_values_stringBuffer(alloc, required);
+    if(val.tag == NN_VALUE_NIL) {
+        nn_error_write(err, "Out of memory");
+        return val;
+    }
+    nn_size_t got = nn_hostfs_read(fs, handle, val.string->data, required, err);
+    if(got == 0) {
+        nn_values_drop(val);
+        return nn_values_nil();
+    }
+    if(!nn_values_shrinkString(&val, got)) {
+        nn_error_write(err, "Out of memory");
+    }
+    return val;
+}
+
+nn_size_t nn_hostfs_seek(nni_hostfs *fs, nni_hosthandle *handle, const char *whence, int off, nn_errorbuf_t err) {
+    if(handle->mode == NNI_HOSTMODE_APPEND) {
+        nn_error_write(err, "Bad file descriptor");
+        return handle->size;
+    }
+    nn_integer_t ptr = handle->position;
+    if(nn_strcmp(whence, "set") == 0) {
+        ptr = off;
+    }
+    if(nn_strcmp(whence, "cur") == 0) {
+        ptr += off;
+    }
+    if(nn_strcmp(whence, "end") == 0) {
+        ptr = handle->size - off;
+    }
+    if(ptr < 0) ptr = 0;
+    if(ptr > (nn_integer_t)handle->size) ptr = handle->size;
+    handle->position = ptr;
+    return handle->position;
+}
+
+nn_filesystem *nn_hostFilesystem(nn_Context *context, nn_hostFilesystemOptions opts, nn_filesystemControl control) {
+    nn_Alloc *alloc = &context->allocator;
+    int rootFd = open(opts.root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(rootFd < 0) return NULL;
+    nni_hostfs *fs = nn_alloc(alloc, sizeof(nni_hostfs));
+    if(fs == NULL) {
+        close(rootFd);
+        return NULL;
+    }
+    fs->ctx = *context;
+    fs->opts = opts;
+    // our own copy, the caller's string may not live as long as us
+    fs->root = nn_strdup(alloc, opts.root);
+    fs->opts.root = fs->root;
+    if(fs->root == NULL) {
+        nn_dealloc(alloc, fs, sizeof(nni_hostfs));
+        close(rootFd);
+        return NULL;
+    }
+    if(fs->opts.labelLen > NN_LABEL_SIZE) fs->opts.labelLen = NN_LABEL_SIZE;
+    fs->rootFd = rootFd;
+    fs->counted = false;
+    fs->bytesUsed = 0;
+    fs->nodesUsed = 0;
+    // generation 0 is never current, so zeroed stat entries are empty
+    fs->statGeneration = 1;
+    fs->fileClock = 0;
+    for(nn_size_t i = 0; i < NNI_HOSTFS_FILES; i++) {
+        fs->files[i] = NULL;
+    }
+    nn_memset(fs->stats, 0, sizeof(fs->stats));
+
+    nn_filesystemTable table = {
+        .userdata = fs,
+        .deinit = (void *)nn_hostfs_deinit,
+        .getLabel = (void *)nn_hostfs_getLabel,
+        .setLabel = (void *)nn_hostfs_setLabel,
+        .spaceUsed = (void *)nn_hostfs_spaceUsed,
+        .spaceUsedIsCounted = true,
+        .nodesUsed = (void *)nn_hostfs_nodesUsed,
+        .spaceTotal = opts.capacity,
+        .isReadOnly = (void *)nn_hostfs_isReadOnly,
+        .size = (void *)nn_hostfs_size,
+        .remove = (void *)nn_hostfs_remove,
+        .lastModified = (void *)nn_hostfs_lastModified,
+        .rename = (void *)nn_hostfs_rename,
+        .exists = (void *)nn_hostfs_exists,
+        .isDirectory = (void *)nn_hostfs_isDirectory,
+        .makeDirectory = (void *)nn_hostfs_makeDirectory,
+        .list = (void *)nn_hostfs_list,
+        .open = (void *)nn_hostfs_open,
+        .close = (void *)nn_hostfs_close,
+        .write = (void *)nn_hostfs_write,
+        .read = (void *)nn_hostfs_read,
+        .readValue = (void *)nn_hostfs_readValue,
+        .seek = (void *)nn_hostfs_seek,
+    };
+    nn_filesystem *filesystem = nn_newFilesystem(context, table, control);
+    if(filesystem == NULL) nn_hostfs_deinit(fs);
+    return filesystem;
+}
+
+#endif
@@ -3,7 +3,7 @@
 typedef struct nn_modemLoop {
     nn_Context ctx;
     nn_debugLoopbackNetworkOpts opts;
-    nn_size_t *openPorts;
+    nn_portSet ports;
     nn_size_t strength;
     char wakeup[NN_MAX_WAKEUPMSG];
     nn_size_t wakeupLen;
@@ -13,79 +13,65 @@ void nn_loopModem_deinit(nn_modemLoop *loop) {
     nn_Context ctx = loop->ctx;
 
 	nn_deallocStr(&ctx.allocator, loop->opts.address);
-    nn_dealloc(&ctx.allocator, loop->openPorts, loop->opts.maxOpenPorts * sizeof(nn_size_t));
     nn_dealloc(&ctx.allocator, loop, sizeof(nn_modemLoop));
 }
 
 nn_bool_t nn_loopModem_isOpen(nn_modemLoop *loop, nn_size_t port, nn_errorbuf_t err) {
-    for(nn_size_t i = 0; i < loop->opts.maxOpenPorts; i++) {
-        if(loop->openPorts[i] == port) {
-			return true;
-		}
-	}
-
-	return false;
+	return nn_portSet_isOpen(&loop->ports, port);
 }
 
 nn_bool_t nn_loopModem_open(nn_modemLoop *loop, nn_size_t port, nn_errorbuf_t err) {
-    int slot = -1;
-    for(nn_size_t i = 0; i < loop->opts.maxOpenPorts; i++) {
-        if(loop->openPorts[i] == NN_PORT_CLOSEALL) {
-            slot = i;
-            break;
-		}
-	}
-
-    if(slot == -1) {
+    if(nn_portSet_isOpen(&loop->ports, port)) return false;
+    if(nn_portSet_isFull(&loop->ports)) {
         nn_error_write(err, "too many open ports");
         return false;
     }
 
-	loop->openPorts[slot] = port;
-
-	return true;
+	return nn_portSet_open(&loop->ports, port);
 }
 
 nn_bool_t nn_loopModem_close(nn_modemLoop *loop, nn_size_t port, nn_errorbuf_t err) {
 	if(port == NN_PORT_CLOSEALL) {
-		for(nn_size_t i = 0; i < loop->opts.maxOpenPorts; i++) loop->openPorts[i] = NN_PORT_CLOSEALL;
+		nn_portSet_closeAll(&loop->ports);
 		return true;
 	}
 
-    for(nn_size_t i = 0; i < loop->opts.maxOpenPorts; i++) {
-        if(loop->openPorts[i] == port) {
-			loop->openPorts[i] = NN_PORT_CLOSEALL;
-            return true;
-		}
-	}
+	if(nn_portSet_close(&loop->ports, port)) return true;
 
 	nn_error_write(err, "port already closed");
 	return false;
 }
 
 nn_size_t nn_loopModem_getPorts(nn_modemLoop *loop, nn_size_t *ports, nn_errorbuf_t err) {
-	nn_size_t len = 0;
-    for(nn_size_t i = 0; i < loop->opts.maxOpenPorts; i++) {
-        if(loop->openPorts[i] != NN_PORT_CLOSEALL) {
-			ports[len] = loop->openPorts[i];
-			len++;
-		}
-	}
-	return len;
+	return nn_portSet_getPorts(&loop->ports, ports);
 }
 
-nn_bool_t nn_loopModem_send(nn_modemLoop *loop, nn_address address, nn_size_t port, nn_value *values, nn_size_t valuec, nn_errorbuf_t err) {
-	if(address == NULL) {
-		// broadcasting, set it to our address
-		address = loop->opts.address;
-	}
-
+nn_bool_t nn_loopModem_sendPacket(nn_modemLoop *loop, nn_address address, nn_packet *packet, nn_errorbuf_t err) {
 	// error is discarded as packet loss
-	nn_pushNetworkMessage(loop->opts.computer, loop->opts.address, address, port, loop->strength, values, valuec);
+	nn_pushPacket(loop->opts.computer, loop->opts.address, packet, loop->strength);
 
 	return true;
 }
 
+// for hosts calling the table themselves, the modem component uses sendPacket
+nn_bool_t nn_loopModem_send(nn_modemLoop *loop, nn_address address, nn_size_t port, nn_value *values, nn_size_t valuec, nn_errorbuf_t err) {
+	nn_size_t size = nn_measurePacketSize(values, valuec);
+	// tables and arrays
+	if(size == (nn_size_t)-1) {
+		nn_error_write(err, "unsupported data type");
+		return false;
+	}
+	// we are the sender, same as when the component sends
+	nn_packet *packet = nn_newMeasuredPacket(&loop->ctx.allocator, loop->opts.address, port, values, valuec, size);
+	if(packet == NULL) {
+		nn_error_write(err, "out of memory");
+		return false;
+	}
+	nn_bool_t res = nn_loopModem_sendPacket(loop, address, packet, err);
+	nn_dropPacket(packet);
+	return res;
+}
+
 double nn_loopModem_getStrength(nn_modemLoop *loop, nn_errorbuf_t err) {
 	return loop->strength;
 }
@@ -113,10 +99,7 @@ nn_modem *nn_debugLoopbackModem(nn_Context *context, nn_debugLoopbackNetworkOpts
     m->opts = opts;
     m->strength = opts.maxStrength;
     m->wakeupLen = 0;
-    m->openPorts = nn_alloc(&context->allocator, opts.maxOpenPorts * sizeof(nn_size_t));
-    for(nn_size_t i = 0; i < opts.maxOpenPorts; i++) {
-        m->openPorts[i] = NN_PORT_CLOSEALL; // used as a NULL port
-    }
+    nn_portSet_init(&m->ports, opts.maxOpenPorts);
     nn_modemTable table = {
         .userdata = m,
         .deinit = (void *)nn_loopModem_deinit,
@@ -132,6 +115,7 @@ nn_modem *nn_debugLoopbackModem(nn_Context *context, nn_debugLoopbackNetworkOpts
 		.getPorts = (void *)nn_loopModem_getPorts,
 
 		.send = (void *)nn_loopModem_send,
+		.sendPacket = (void *)nn_loopModem_sendPacket,
 
         .maxStrength = opts.maxStrength,
 		.getStrength = (void *)nn_loopModem_getStrength,
@@ -23,6 +23,10 @@ nn_guard *nn_getModemLock(nn_modem *modem) {
     return modem->lock;
 }
 
+nn_modemTable *nn_getModemTable(nn_modem *modem) {
+    return &modem->table;
+}
+
 void nn_retainModem(nn_modem *modem) {
     nn_incRef(&modem->refc);
 }
@@ -40,6 +44,58 @@ nn_bool_t nn_destroyModem(nn_modem *modem) {
     return true;
 }
 
+void nn_portSet_init(nn_portSet *set, nn_size_t maxOpenPorts) {
+    set->count = 0;
+    set->max = maxOpenPorts;
+    nn_memset(set->bits, 0, sizeof(set->bits));
+}
+
+nn_bool_t nn_portSet_isOpen(const nn_portSet *set, nn_size_t port) {
+    if(port > NN_PORT_MAX) return false;
+    return (set->bits[port / NN_PORTSET_WORD_BITS] >> (port % NN_PORTSET_WORD_BITS)) & 1;
+}
+
+nn_bool_t nn_portSet_isFull(const nn_portSet *set) {
+    return set->count >= set->max;
+}
+
+nn_bool_t nn_portSet_open(nn_portSet *set, nn_size_t port) {
+    if(port > NN_PORT_MAX) return false;
+    if(nn_portSet_isOpen(set, port) || nn_portSet_isFull(set)) return false;
+    set->bits[port / NN_PORTSET_WORD_BITS] |= (nn_size_t)1 << (port % NN_PORTSET_WORD_BITS);
+    set->count++;
+    return true;
+}
+
+nn_bool_t nn_portSet_close(nn_portSet *set, nn_size_t port) {
+    if(!nn_portSet_isOpen(set, port)) return false;
+    set->bits[port / NN_PORTSET_WORD_BITS] &= ~((nn_size_t)1 << (port % NN_PORTSET_WORD_BITS));
+    set->count--;
+    return true;
+}
+
+void nn_portSet_closeAll(nn_portSet *set) {
+    if(set->count == 0) return;
+    nn_memset(set->bits, 0, sizeof(set->bits));
+    set->count = 0;
+}
+
+nn_size_t nn_portSet_getPorts(const nn_portSet *set, nn_size_t *ports) {
+    nn_size_t len = 0;
+    nn_size_t words = sizeof(set->bits) / sizeof(set->bits[0]);
+    for(nn_size_t w = 0; w < words && len < set->count; w++) {
+        nn_size_t word = set->bits[w];
+        // most words are empty
+        for(nn_size_t b = 0; word != 0; b++, word >>= 1) {
+            if(word & 1) {
+                ports[len] = w * NN_PORTSET_WORD_BITS + b;
+                len++;
+            }
+        }
+    }
+    return len;
+}
+
 void nn_modem_destroy(void *_, nn_component *component, nn_modem *modem) {
     nn_destroyModem(modem);
 }
@@ -183,6 +239,44 @@ static void nni_modem_getPorts(nn_modem *modem, void *_, nn_component *component
     }
 }
 
+// the bit send and broadcast share, address is NULL when broadcasting
+static void nni_modem_transmit(nn_modem *modem, nn_component *component, nn_computer *computer, nn_address addr, nn_integer_t port, nn_value *vals, nn_size_t valLen) {
+	// the only time the values get measured, the packet remembers it
+	nn_size_t bytesSent = nn_measurePacketSize(vals, valLen);
+	if(bytesSent > modem->table.maxPacketSize) {
+        nn_setCError(computer, "packet too big");
+        return;
+	}
+	nn_simulateBufferedIndirect(component, bytesSent, modem->ctrl.packetBytesPerTick);
+	double d = (double)bytesSent / modem->table.maxPacketSize;
+	nn_addHeat(computer, d * modem->ctrl.heatPerFullPacket);
+	nn_removeEnergy(computer, d * modem->ctrl.energyPerFullPacket);
+
+    nn_errorbuf_t err = "";
+    nn_bool_t res;
+    if(modem->table.sendPacket != NULL) {
+        nn_packet *packet = nn_newMeasuredPacket(&modem->ctx.allocator, nn_getComponentAddress(component), port, vals, valLen, bytesSent);
+        if(packet == NULL) {
+            nn_setCError(computer, "out of memory");
+            return;
+        }
+        nn_lock(&modem->ctx, modem->lock);
+        res = modem->table.sendPacket(modem->table.userdata, addr, packet, err);
+        nn_unlock(&modem->ctx, modem->lock);
+        nn_dropPacket(packet);
+    } else {
+        nn_lock(&modem->ctx, modem->lock);
+        res = modem->table.send(modem->table.userdata, addr, port, vals, valLen, err);
+        nn_unlock(&modem->ctx, modem->lock);
+    }
+    if(!nn_error_isEmpty(err)) {
+        nn_setError(computer, err);
+        return;
+    }
+
+    nn_return_boolean(computer, res);
+}
+
 static void nni_modem_send(nn_modem *modem, void *_, nn_component *component, nn_computer *computer) {
     // we pinky promise it won't do a fucky wucky
     nn_address addr = (nn_address)nn_toCString(nn_getArgument(computer, 0));
@@ -208,26 +302,7 @@ static void nni_modem_send(nn_modem *modem, void *_, nn_component *component, nn
         vals[i] = nn_getArgument(computer, i + 2);
     }
 
-	nn_size_t bytesSent = nn_measurePacketSize(vals, valLen);
-	if(bytesSent > modem->table.maxPacketSize) {
-        nn_setCError(computer, "packet too big");
-        return;
-	}
-	nn_simulateBufferedIndirect(component, bytesSent, modem->ctrl.packetBytesPerTick);
-	double d = (double)bytesSent / modem->table.maxPacketSize;
-	nn_addHeat(computer, d * modem->ctrl.heatPerFullPacket);
-	nn_removeEnergy(computer, d * modem->ctrl.energyPerFullPacket);
-
-    nn_errorbuf_t err = "";
-    nn_lock(&modem->ctx, modem->lock);
-    nn_bool_t res = modem->table.send(modem->table.userdata, addr, port, vals, valLen, err);
-    nn_unlock(&modem->ctx, modem->lock);
-    if(!nn_error_isEmpty(err)) {
-        nn_setError(computer, err);
-        return;
-    }
-
-    nn_return_boolean(computer, res);
+    nni_modem_transmit(modem, component, computer, addr, port, vals, valLen);
 }
 
 static void nni_modem_broadcast(nn_modem *modem, void *_, nn_component *component, nn_computer *computer) {
@@ -249,26 +324,7 @@ static void nni_modem_broadcast(nn_modem *modem, void *_, nn_component *componen
         vals[i] = nn_getArgument(computer, i + 1);
     }
 	
-	nn_size_t bytesSent = nn_measurePacketSize(vals, valLen);
-	if(bytesSent > modem->table.maxPacketSize) {
-        nn_setCError(computer, "packet too big");
-        return;
-	}
-	nn_simulateBufferedIndirect(component, bytesSent, modem->ctrl.packetBytesPerTick);
-	double d = (double)bytesSent / modem->table.maxPacketSize;
-	nn_addHeat(computer, d * modem->ctrl.heatPerFullPacket);
-	nn_removeEnergy(computer, d * modem->ctrl.energyPerFullPacket);
-
-    nn_errorbuf_t err = "";
-    nn_lock(&modem->ctx, modem->lock);
-    nn_bool_t res = modem->table.send(modem->table.userdata, NULL, port, vals, valLen, err);
-    nn_unlock(&modem->ctx, modem->lock);
-    if(!nn_error_isEmpty(err)) {
-        nn_setError(computer, err);
-        return;
-    }
-
-    nn_return_boolean(computer, res);
+    nni_modem_transmit(modem, component, computer, NULL, port, vals, valLen);
 }
 
 static void nni_modem_getWake(nn_modem *modem, void *_, nn_component *component, nn_computer *computer) {
@@ -1,11 +1,32 @@
 #include "screen.h"
 
+nni_cell nni_packCell(nn_scrchr_t pixel) {
+    unsigned int glyph = pixel.codepoint & NNI_CELL_CODEPOINT;
+    if(pixel.isFgPalette) glyph |= NNI_CELL_FGPALETTE;
+    if(pixel.isBgPalette) glyph |= NNI_CELL_BGPALETTE;
+    return (nni_cell) {
+        .glyph = glyph,
+        .fg = pixel.fg,
+        .bg = pixel.bg,
+    };
+}
+
+nn_scrchr_t nni_unpackCell(nni_cell cell) {
+    return (nn_scrchr_t) {
+        .codepoint = cell.glyph & NNI_CELL_CODEPOINT,
+        .fg = cell.fg,
+        .bg = cell.bg,
+        .isFgPalette = (cell.glyph & NNI_CELL_FGPALETTE) != 0,
+        .isBgPalette = (cell.glyph & NNI_CELL_BGPALETTE) != 0,
+    };
+}
+
 nn_screen *nn_newScreen(nn_Context *context, int maxWidth, int maxHeight, int maxDepth, int editableColors, int paletteColors) {
     nn_Alloc *alloc = &context->allocator;
 	// TODO: handle OOMs
     nn_screen *screen = nn_alloc(alloc, sizeof(nn_screen));
     screen->ctx = *context;
-    screen->buffer = nn_alloc(alloc, sizeof(nn_scrchr_t) * maxWidth * maxHeight);
+    screen->buffer = nn_alloc(alloc, sizeof(nni_cell) * maxWidth * maxHeight);
     screen->lock = nn_newGuard(context);
     screen->refc = 1;
     screen->width = maxWidth;
@@ -26,6 +47,10 @@ nn_screen *nn_newScreen(nn_Context *context, int maxWidth, int maxHeight, int ma
     screen->isTouchModeInverted = true;
     screen->isPrecise = true;
     screen->isDirty = true;
+    screen->damage = nn_alloc(alloc, sizeof(nni_damageSpan) * maxHeight);
+    nn_clearDamage(screen);
+    nn_damageScreen(screen, 0, 0, maxWidth, maxHeight);
+    screen->colorCache = NULL;
     screen->keyboardCount = 0;
     return screen;
 }
@@ -38,7 +63,12 @@ void nn_destroyScreen(nn_screen *screen) {
     if(!nn_decRef(&screen->refc)) return;
     nn_Alloc a = screen->ctx.allocator;
     nn_deleteGuard(&screen->ctx, screen->lock);
-    nn_dealloc(&a, screen->buffer, sizeof(nn_scrchr_t) * screen->maxWidth * screen->maxHeight);
+    nn_dealloc(&a, screen->buffer, sizeof(nni_cell) * screen->maxWidth * screen->maxHeight);
+    nn_dealloc(&a, screen->damage, sizeof(nni_damageSpan) * screen->maxHeight);
+    if(screen->colorCache != NULL) {
+        nn_dealloc(&a, screen->colorCache->palette, sizeof(int) * screen->paletteColors);
+        nn_dealloc(&a, screen->colorCache, sizeof(nni_colorCache));
+    }
     nn_dealloc(&a, screen->palette, sizeof(int) * screen->paletteColors);
     nn_dealloc(&a, screen, sizeof(nn_screen));
 }
@@ -64,29 +94,39 @@ void nn_maxResolution(nn_screen *screen, int *width, int *height) {
 void nn_setResolution(nn_screen *screen, int width, int height) {
     screen->width = width;
     screen->height = height;
+    nn_damageScreen(screen, 0, 0, screen->maxWidth, screen->maxHeight);
 }
 
 nn_bool_t nn_unsafeReallocateScreenBuffer(nn_screen *screen, int maxWidth, int maxHeight) {
 	nn_Alloc *alloc = &screen->ctx.allocator;
 
-	nn_scrchr_t *newBuffer = nn_alloc(alloc, sizeof(nn_scrchr_t) * maxWidth * maxHeight);
+	nni_cell *newBuffer = nn_alloc(alloc, sizeof(nni_cell) * maxWidth * maxHeight);
 	if(newBuffer == NULL) {
 		return false;
 	}
+	nni_damageSpan *newDamage = nn_alloc(alloc, sizeof(nni_damageSpan) * maxHeight);
+	if(newDamage == NULL) {
+		nn_dealloc(alloc, newBuffer, sizeof(nni_cell) * maxWidth * maxHeight);
+		return false;
+	}
 
 	for(nn_size_t y = 0; y < maxHeight; y++) {
 		for(nn_size_t x = 0; x < maxWidth; x++) {
 			nn_size_t destIdx = x + y * maxWidth;
 
-			newBuffer[destIdx] = nn_getPixel(screen, x, y);
+			newBuffer[destIdx] = nni_packCell(nn_getPixel(screen, x, y));
 		}
 	}
 
-	nn_dealloc(alloc, screen->buffer, sizeof(nn_scrchr_t) * screen->maxWidth * screen->maxHeight);
+	nn_dealloc(alloc, screen->buffer, sizeof(nni_cell) * screen->maxWidth * screen->maxHeight);
+	nn_dealloc(alloc, screen->damage, sizeof(nni_damageSpan) * screen->maxHeight);
 
 	screen->buffer = newBuffer;
+	screen->damage = newDamage;
 	screen->maxWidth = maxWidth;
 	screen->maxHeight = maxHeight;
+	nn_clearDamage(screen);
+	nn_damageScreen(screen, 0, 0, maxWidth, maxHeight);
 	return true;
 }
 
@@ -149,7 +189,13 @@ int nn_getEditableColors(nn_screen *screen) {
 
 void nn_setPaletteColor(nn_screen *screen, int idx, int color) {
     if(idx >= screen->paletteColors) return;
+    if(screen->palette[idx] == color) return;
     screen->palette[idx] = color;
+    if(screen->colorCache != NULL) {
+        screen->colorCache->depth = -1;
+    }
+    // we don't know which cells use it
+    nn_damageScreen(screen, 0, 0, screen->maxWidth, screen->maxHeight);
 }
 
 int nn_getPaletteColor(nn_screen *screen, int idx) {
@@ -171,7 +217,12 @@ int nn_getDepth(nn_screen *screen) {
 
 void nn_setDepth(nn_screen *screen, int depth) {
     if(depth > screen->maxDepth) depth = screen->maxDepth;
+    if(screen->depth == depth) return;
     screen->depth = depth;
+    if(screen->colorCache != NULL) {
+        screen->colorCache->depth = -1;
+    }
+    nn_damageScreen(screen, 0, 0, screen->maxWidth, screen->maxHeight);
 }
 
 void nn_setPixel(nn_screen *screen, int x, int y, nn_scrchr_t pixel) {
@@ -179,8 +230,16 @@ void nn_setPixel(nn_screen *screen, int x, int y, nn_scrchr_t pixel) {
     if(y < 0) return;
     if(x >= screen->width) return;
     if(y >= screen->height) return;
-    screen->buffer[x + y * screen->maxWidth] = pixel;
+    screen->buffer[x + y * screen->maxWidth] = nni_packCell(pixel);
     screen->isDirty = true; // stuff changed
+    nni_damageSpan *span = screen->damage + y;
+    if(span->start >= span->end) {
+        span->start = x;
+        span->end = x + 1;
+        return;
+    }
+    if(x < span->start) span->start = x;
+    if(x >= span->end) span->end = x + 1;
 }
 
 nn_scrchr_t nn_getPixel(nn_screen *screen, int x, int y) {
@@ -195,7 +254,7 @@ nn_scrchr_t nn_getPixel(nn_screen *screen, int x, int y) {
     if(y < 0) return blank;
     if(x >= screen->width) return blank;
     if(y >= screen->height) return blank;
-    return screen->buffer[x + y * screen->maxWidth];
+    return nni_unpackCell(screen->buffer[x + y * screen->maxWidth]);
 }
 
 nn_bool_t nn_isDirty(nn_screen *screen) {
@@ -203,7 +262,66 @@ nn_bool_t nn_isDirty(nn_screen *screen) {
 }
 
 void nn_setDirty(nn_screen *screen, nn_bool_t dirty) {
-    screen->isDirty = dirty;
+    if(dirty) {
+        nn_damageScreen(screen, 0, 0, screen->maxWidth, screen->maxHeight);
+    } else {
+        nn_clearDamage(screen);
+    }
+}
+
+void nn_damageScreen(nn_screen *screen, int x, int y, int width, int height) {
+    if(x < 0) {
+        width += x;
+        x = 0;
+    }
+    if(y < 0) {
+        height += y;
+        y = 0;
+    }
+    if(x + width > screen->maxWidth) width = screen->maxWidth - x;
+    if(y + height > screen->maxHeight) height = screen->maxHeight - y;
+    if(width <= 0 || height <= 0) return;
+
+    screen->isDirty = true;
+    for(int j = y; j < y + height; j++) {
+        nni_damageSpan *span = screen->damage + j;
+        if(span->start >= span->end) {
+            span->start = x;
+            span->end = x + width;
+            continue;
+        }
+        if(x < span->start) span->start = x;
+        if(x + width > span->end) span->end = x + width;
+    }
+}
+
+nn_bool_t nn_iterDamage(nn_screen *screen, nn_size_t *internalIndex, nn_screenRect *rect) {
+    nn_size_t y = *internalIndex;
+    nn_size_t h = screen->maxHeight;
+    while(y < h && screen->damage[y].start >= screen->damage[y].end) y++;
+    if(y == h) {
+        *internalIndex = h;
+        return false;
+    }
+    nni_damageSpan span = screen->damage[y];
+    // merge rows with the same span, so a full clear is 1 rectangle
+    nn_size_t end = y + 1;
+    while(end < h && screen->damage[end].start == span.start && screen->damage[end].end == span.end) end++;
+
+    rect->x = span.start;
+    rect->y = y;
+    rect->width = span.end - span.start;
+    rect->height = end - y;
+    *internalIndex = end;
+    return true;
+}
+
+void nn_clearDamage(nn_screen *screen) {
+    for(int y = 0; y < screen->maxHeight; y++) {
+        screen->damage[y].start = 0;
+        screen->damage[y].end = 0;
+    }
+    screen->isDirty = false;
 }
 
 nn_bool_t nn_isPrecise(nn_screen *screen) {
@@ -276,6 +394,7 @@ void nn_screenComp_turnOn(nn_screen *screen, void *_, nn_component *component, n
 
 	nn_bool_t isOff = !nn_isOn(screen);
 	nn_setOn(screen, true);
+	if(isOff) nn_setDirty(screen, true);
 
     nn_unlockScreen(screen);
 
@@ -510,3 +629,68 @@ int nn_mapDepth(int color, int depth, nn_bool_t legacy) {
     }
     return color;
 }
+
+static nni_colorCache *nni_screen_colorCache(nn_screen *screen, nn_bool_t legacy) {
+    nn_Alloc *alloc = &screen->ctx.allocator;
+    nni_colorCache *cache = screen->colorCache;
+    if(cache == NULL) {
+        cache = nn_alloc(alloc, sizeof(nni_colorCache));
+        if(cache == NULL) return NULL;
+        cache->palette = nn_alloc(alloc, sizeof(int) * screen->paletteColors);
+        if(cache->palette == NULL) {
+            nn_dealloc(alloc, cache, sizeof(nni_colorCache));
+            return NULL;
+        }
+        cache->depth = -1;
+        screen->colorCache = cache;
+    }
+    if(cache->depth == screen->depth && cache->legacy == legacy) return cache;
+
+    // rebuild it
+    cache->depth = screen->depth;
+    cache->legacy = legacy;
+    for(nn_size_t i = 0; i < NNI_COLORCACHE_SIZE; i++) {
+        cache->keys[i] = -1; // colors are never negative
+    }
+    for(int i = 0; i < screen->paletteColors; i++) {
+        cache->palette[i] = nn_mapDepth(screen->palette[i], cache->depth, legacy);
+    }
+    return cache;
+}
+
+static int nni_colorCache_map(nni_colorCache *cache, int color) {
+    color &= 0xFFFFFF;
+    unsigned int slot = ((unsigned int)color * 2654435761u) % NNI_COLORCACHE_SIZE;
+    if(cache->keys[slot] != color) {
+        cache->keys[slot] = color;
+        cache->values[slot] = nn_mapDepth(color, cache->depth, cache->legacy);
+    }
+    return cache->values[slot];
+}
+
+static int nni_screen_mapColor(nn_screen *screen, nni_colorCache *cache, int color, nn_bool_t isPalette) {
+    if(isPalette) {
+        if(color < 0 || color >= screen->paletteColors) return 0;
+        return cache->palette[color];
+    }
+    return nni_colorCache_map(cache, color);
+}
+
+int nn_screen_mapRow(nn_screen *screen, int x, int y, int width, nn_bool_t legacy, unsigned int *codepoints, int *fg, int *bg) {
+    if(y < 0 || y >= screen->maxHeight) return 0;
+    if(x < 0 || x >= screen->maxWidth) return 0;
+    if(x + width > screen->maxWidth) width = screen->maxWidth - x;
+    if(width <= 0) return 0;
+
+    nni_colorCache *cache = nni_screen_colorCache(screen, legacy);
+    if(cache == NULL) return 0;
+
+    nni_cell *row = screen->buffer + x + y * screen->maxWidth;
+    for(int i = 0; i < width; i++) {
+        nni_cell cell = row[i];
+        if(codepoints != NULL) codepoints[i] = cell.glyph & NNI_CELL_CODEPOINT;
+        if(fg != NULL) fg[i] = nni_screen_mapColor(screen, cache, cell.fg, (cell.glyph & NNI_CELL_FGPALETTE) != 0);
+        if(bg != NULL) bg[i] = nni_screen_mapColor(screen, cache, cell.bg, (cell.glyph & NNI_CELL_BGPALETTE) != 0);
+    }
+    return width;
+}
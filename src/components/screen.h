@@ -3,9 +3,45 @@
 
 #include "../neonucleus.h"
 
+// How cells are actually stored, in screens and GPU VRAM buffers.
+// nn_scrchr_t has padding after the 2 flags, this doesn't, so rows of these
+// can be compared and moved around with plain memory operations.
+// Convert with nni_packCell() and nni_unpackCell().
+typedef struct nni_cell {
+    // codepoint in the low 21 bits, then the palette flags
+    unsigned int glyph;
+    int fg;
+    int bg;
+} nni_cell;
+
+#define NNI_CELL_CODEPOINT 0x1FFFFF
+#define NNI_CELL_FGPALETTE (1u << 21)
+#define NNI_CELL_BGPALETTE (1u << 22)
+
+nni_cell nni_packCell(nn_scrchr_t pixel);
+nn_scrchr_t nni_unpackCell(nni_cell cell);
+
+// the damaged columns of a row, [start, end). Clean if start >= end
+typedef struct nni_damageSpan {
+    int start;
+    int end;
+} nni_damageSpan;
+
+// direct-mapped cache of nn_mapDepth() results, for whatever depth it was built for
+#define NNI_COLORCACHE_SIZE 1024
+
+typedef struct nni_colorCache {
+    int depth;
+    nn_bool_t legacy;
+    int keys[NNI_COLORCACHE_SIZE];
+    int values[NNI_COLORCACHE_SIZE];
+    // the palette, already mapped
+    int *palette;
+} nni_colorCache;
+
 typedef struct nn_screen {
     nn_Context ctx;
-    nn_scrchr_t *buffer;
+    nni_cell *buffer;
     nn_guard *lock;
     nn_refc refc;
     int width;
@@ -25,6 +61,10 @@ typedef struct nn_screen {
     nn_bool_t isTouchModeInverted;
     nn_bool_t isPrecise;
     nn_bool_t isDirty;
+    // one per row, maxHeight of them
+    nni_damageSpan *damage;
+    // NULL until someone maps colors
+    nni_colorCache *colorCache;
     nn_address keyboards[NN_MAX_SCREEN_KEYBOARDS];
     nn_size_t keyboardCount;
 } nn_screen;
@@ -1,10 +1,16 @@
 #include "../neonucleus.h"
 
-// TODO: make it allocate lazily
+// The drive is a page table of blocks, each allocated on the first write to it.
+// Blocks which were never written read as zeroes, so an empty drive costs next to nothing.
+
+// how many bytes a block covers, rounded up to whole sectors
+#define NNI_VDRIVE_BLOCK 4096
 
 typedef struct nn_vdrive {
     nn_Context ctx;
-    char *buffer;
+    char **blocks;
+    nn_size_t blockCount;
+    nn_size_t blockSize;
     nn_size_t sectorSize;
     nn_size_t capacity;
     char label[NN_LABEL_SIZE];
@@ -13,7 +19,10 @@ typedef struct nn_vdrive {
 
 static void nni_vdrive_deinit(nn_vdrive *vdrive) {
     nn_Alloc a = vdrive->ctx.allocator;
-    nn_dealloc(&a, vdrive->buffer, vdrive->capacity);
+    for(nn_size_t i = 0; i < vdrive->blockCount; i++) {
+        nn_dealloc(&a, vdrive->blocks[i], vdrive->blockSize);
+    }
+    nn_dealloc(&a, vdrive->blocks, sizeof(char *) * vdrive->blockCount);
     nn_dealloc(&a, vdrive, sizeof(nn_vdrive));
 }
 
@@ -29,34 +38,104 @@ static nn_size_t nni_vdrive_setLabel(nn_vdrive *vdrive, const char *buf, nn_size
     return buflen;
 }
 
+static nn_bool_t nni_vdrive_isZero(const char *buf, nn_size_t len) {
+    for(nn_size_t i = 0; i < len; i++) {
+        if(buf[i] != 0) return false;
+    }
+    return true;
+}
+
+// copies len bytes at offset into the drive, allocating blocks as needed
+static void nni_vdrive_store(nn_vdrive *vdrive, nn_size_t offset, nn_size_t len, const char *buf, nn_errorbuf_t err) {
+    while(len > 0) {
+        nn_size_t block = offset / vdrive->blockSize;
+        nn_size_t inBlock = offset % vdrive->blockSize;
+        nn_size_t chunk = vdrive->blockSize - inBlock;
+        if(chunk > len) chunk = len;
+        char *data = vdrive->blocks[block];
+        if(data == NULL && !nni_vdrive_isZero(buf, chunk)) {
+            data = nn_alloc(&vdrive->ctx.allocator, vdrive->blockSize);
+            if(data == NULL) {
+                nn_error_write(err, "out of memory");
+                return;
+            }
+            nn_memset(data, 0, vdrive->blockSize);
+            vdrive->blocks[block] = data;
+        }
+        if(data != NULL) nn_memcpy(data + inBlock, buf, chunk);
+        offset += chunk;
+        buf += chunk;
+        len -= chunk;
+    }
+}
+
+static void nni_vdrive_load(nn_vdrive *vdrive, nn_size_t offset, nn_size_t len, char *buf) {
+    while(len > 0) {
+        nn_size_t block = offset / vdrive->blockSize;
+        nn_size_t inBlock = offset % vdrive->blockSize;
+        nn_size_t chunk = vdrive->blockSize - inBlock;
+        if(chunk > len) chunk = len;
+        char *data = vdrive->blocks[block];
+        if(data == NULL) {
+            nn_memset(buf, 0, chunk);
+        } else {
+            nn_memcpy(buf, data + inBlock, chunk);
+        }
+        offset += chunk;
+        buf += chunk;
+        len -= chunk;
+    }
+}
+
 static void nni_vdrive_readSector(nn_vdrive *vdrive, int sector, char *buf) {
-    nn_memcpy(buf, vdrive->buffer + (sector - 1) * vdrive->sectorSize, vdrive->sectorSize);
+    nni_vdrive_load(vdrive, (sector - 1) * vdrive->sectorSize, vdrive->sectorSize, buf);
+}
+
+static void nni_vdrive_writeSector(nn_vdrive *vdrive, int sector, const char *buf, nn_errorbuf_t err) {
+    nni_vdrive_store(vdrive, (sector - 1) * vdrive->sectorSize, vdrive->sectorSize, buf, err);
+}
+
+static void nni_vdrive_readSectors(nn_vdrive *vdrive, int sector, nn_size_t count, char *buf) {
+    nni_vdrive_load(vdrive, (sector - 1) * vdrive->sectorSize, count * vdrive->sectorSize, buf);
 }
 
-static void nni_vdrive_writeSector(nn_vdrive *vdrive, int sector, const char *buf) {
-    nn_memcpy(vdrive->buffer + (sector - 1) * vdrive->sectorSize, buf, vdrive->sectorSize);
+static void nni_vdrive_writeSectors(nn_vdrive *vdrive, int sector, nn_size_t count, const char *buf, nn_errorbuf_t err) {
+    nni_vdrive_store(vdrive, (sector - 1) * vdrive->sectorSize, count * vdrive->sectorSize, buf, err);
 }
 
 nn_drive *nn_volatileDrive(nn_Context *context, nn_vdriveOptions opts, nn_driveControl control) {
     nn_Alloc *alloc = &context->allocator;
 
-    char *buffer = nn_alloc(alloc, opts.capacity);
-    if(buffer == NULL) return NULL;
     nn_vdrive *drive = nn_alloc(alloc, sizeof(nn_vdrive));
-    if(drive == NULL) {
-        nn_dealloc(alloc, buffer, opts.capacity);
+    if(drive == NULL) return NULL;
+    // whole sectors, so a sector never straddles 2 blocks
+    nn_size_t blockSize = opts.sectorSize;
+    if(blockSize < NNI_VDRIVE_BLOCK) blockSize = (NNI_VDRIVE_BLOCK / opts.sectorSize) * opts.sectorSize;
+    nn_size_t blockCount = (opts.capacity + blockSize - 1) / blockSize;
+    char **blocks = nn_alloc(alloc, sizeof(char *) * blockCount);
+    if(blocks == NULL) {
+        nn_dealloc(alloc, drive, sizeof(nn_vdrive));
         return NULL;
     }
+    for(nn_size_t i = 0; i < blockCount; i++) {
+        blocks[i] = NULL;
+    }
     drive->ctx = *context;
-    drive->buffer = buffer;
+    drive->blocks = blocks;
+    drive->blockCount = blockCount;
+    drive->blockSize = blockSize;
     drive->sectorSize = opts.sectorSize;
     drive->capacity = opts.capacity;
     nn_memcpy(drive->label, opts.label, opts.labelLen);
     drive->labelLen = opts.labelLen;
-    if(opts.data == NULL) {
-        nn_memset(buffer, 0, opts.capacity);
-    } else {
-        nn_memcpy(buffer, opts.data, opts.capacity);
+    if(opts.data != NULL) {
+        // zeroed parts of the image stay unallocated
+        nn_errorbuf_t err = "";
+        nni_vdrive_store(drive, 0, opts.capacity, opts.data, err);
+        if(!nn_error_isEmpty(err)) {
+            nni_vdrive_deinit(drive);
+            return NULL;
+        }
     }
 
     nn_driveTable table = {
@@ -66,9 +145,15 @@ nn_drive *nn_volatileDrive(nn_Context *context, nn_vdriveOptions opts, nn_driveC
         .setLabel = (void *)nni_vdrive_setLabel,
         .readSector = (void *)nni_vdrive_readSector,
         .writeSector = (void *)nni_vdrive_writeSector,
+        .readSectors = (void *)nni_vdrive_readSectors,
+        .writeSectors = (void *)nni_vdrive_writeSectors,
+        .readBytes = (void *)nni_vdrive_load,
+        .writeBytes = (void *)nni_vdrive_store,
         .sectorSize = opts.sectorSize,
         .platterCount = opts.platterCount,
         .capacity = opts.capacity,
     };
-    return nn_newDrive(context, table, control);
+    nn_drive *d = nn_newDrive(context, table, control);
+    if(d == NULL) nni_vdrive_deinit(drive);
+    return d;
 }
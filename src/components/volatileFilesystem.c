@@ -2,19 +2,39 @@
 
 // Data structures
 
+// directories with at least this many entries get a hash index
+#define NNI_VF_INDEX_MIN 16
+// nodes are allocated this many at a time
+#define NNI_VF_SLAB_SIZE 64
+
+// Names are interned per filesystem, so every "init.lua" shares 1 copy,
+// and comparing names is comparing pointers.
+typedef struct nni_vfname {
+    nn_size_t refc;
+    unsigned int hash;
+    nn_size_t len;
+    char data[];
+} nni_vfname;
+
 typedef struct nn_vfnode {
     struct nn_vfilesystem *fs;
-    char name[NN_MAX_PATH];
+    nni_vfname *name;
+    // also links free nodes together
     struct nn_vfnode *parent;
     nn_bool_t isDirectory;
     union {
-        // if directory
+        // if directory, grows on demand up to maxDirEntries
         struct nn_vfnode **entries;
-        // if file
+        // if file. If cap is 0 but data isn't NULL, it belongs to the shared image
+        // and gets copied on the first write.
         char *data;
     };
     nn_size_t len;
     nn_size_t cap;
+    // if directory, linear probing index of entries by name. Stores entry index + 1, 0 means empty.
+    // NULL for small directories, or if we couldn't allocate it.
+    nn_size_t *index;
+    nn_size_t indexCap;
     nn_timestamp_t lastModified;
     // this is used to block deleting
     nn_refc handleCount;
@@ -32,13 +52,40 @@ typedef struct nn_vfhandle {
     nn_vfmode mode;
 } nn_vfhandle;
 
+typedef struct nni_vfslab {
+    struct nni_vfslab *next;
+    nn_vfnode nodes[NNI_VF_SLAB_SIZE];
+} nni_vfslab;
+
 typedef struct nn_vfilesystem {
     nn_Context ctx;
     nn_vfilesystemOptions opts;
     double birthday;
     nn_vfnode *root;
+    nni_vfslab *slabs;
+    nn_vfnode *freeNodes;
+    // running totals, so spaceUsed() doesn't walk the tree
+    nn_size_t bytesUsed;
+    nn_size_t nodesUsed;
+    // linear probing set of every name in use, size is a power of 2
+    nni_vfname **names;
+    nn_size_t nameCap;
+    nn_size_t nameCount;
+    // the image our files borrow from, if any
+    struct nn_fsImage *image;
 } nn_vfilesystem;
 
+typedef struct nn_fsImage {
+    nn_Context ctx;
+    nn_refc refc;
+    nn_vfilesystemImageNode *nodes;
+    nn_size_t nodeCount;
+    nn_size_t rootEntries;
+    // every name and every file, in one allocation
+    char *blob;
+    nn_size_t blobSize;
+} nn_fsImage;
+
 // virtual node helpers
 
 nn_timestamp_t nn_vf_now(nn_vfilesystem *fs) {
@@ -49,46 +96,148 @@ nn_timestamp_t nn_vf_now(nn_vfilesystem *fs) {
     return fs->opts.creationTime + elapsedMS;
 }
 
-nn_vfnode *nn_vf_allocFile(nn_vfilesystem *fs, const char *name) {
+// name interning
+
+static nni_vfname *nni_vf_lookupName(nn_vfilesystem *fs, const char *name, nn_size_t len, unsigned int hash, nn_size_t *slot) {
+    nn_size_t mask = fs->nameCap - 1;
+    nn_size_t i = hash & mask;
+    for(; fs->names[i] != NULL; i = (i + 1) & mask) {
+        nni_vfname *n = fs->names[i];
+        if(n->hash != hash || n->len != len) continue;
+        nn_bool_t same = true;
+        for(nn_size_t j = 0; j < len; j++) {
+            if(n->data[j] != name[j]) {
+                same = false;
+                break;
+            }
+        }
+        if(same) break;
+    }
+    if(slot != NULL) *slot = i;
+    return fs->names[i];
+}
+
+static nn_bool_t nni_vf_growNames(nn_vfilesystem *fs) {
     nn_Alloc *alloc = &fs->ctx.allocator;
-    nn_vfnode *node = nn_alloc(alloc, sizeof(nn_vfnode));
-    if(node == NULL) return NULL;
+    nn_size_t cap = fs->nameCap * 2;
+    nni_vfname **names = nn_alloc(alloc, sizeof(nni_vfname *) * cap);
+    if(names == NULL) return false;
+    for(nn_size_t i = 0; i < cap; i++) names[i] = NULL;
+    for(nn_size_t i = 0; i < fs->nameCap; i++) {
+        nni_vfname *n = fs->names[i];
+        if(n == NULL) continue;
+        nn_size_t j = n->hash & (cap - 1);
+        while(names[j] != NULL) j = (j + 1) & (cap - 1);
+        names[j] = n;
+    }
+    nn_dealloc(alloc, fs->names, sizeof(nni_vfname *) * fs->nameCap);
+    fs->names = names;
+    fs->nameCap = cap;
+    return true;
+}
+
+static nni_vfname *nni_vf_intern(nn_vfilesystem *fs, const char *name) {
+    nn_size_t len = nn_strlen(name);
+    unsigned int hash = nn_memhash(name, len);
+    nn_size_t slot;
+    nni_vfname *n = nni_vf_lookupName(fs, name, len, hash, &slot);
+    if(n != NULL) {
+        n->refc++;
+        return n;
+    }
+    // at most half full
+    if((fs->nameCount + 1) * 2 > fs->nameCap) {
+        if(!nni_vf_growNames(fs)) return NULL;
+        nni_vf_lookupName(fs, name, len, hash, &slot);
+    }
+    n = nn_alloc(&fs->ctx.allocator, sizeof(nni_vfname) + len + 1);
+    if(n == NULL) return NULL;
+    n->refc = 1;
+    n->hash = hash;
+    n->len = len;
+    nn_memcpy(n->data, name, len);
+    n->data[len] = '\0';
+    fs->names[slot] = n;
+    fs->nameCount++;
+    return n;
+}
+
+static void nni_vf_releaseName(nn_vfilesystem *fs, nni_vfname *name) {
+    name->refc--;
+    if(name->refc > 0) return;
+    nn_size_t mask = fs->nameCap - 1;
+    nn_size_t i;
+    nni_vf_lookupName(fs, name->data, name->len, name->hash, &i);
+    // backward shift deletion, so lookups never need tombstones
+    nn_size_t j = i;
+    while(true) {
+        j = (j + 1) & mask;
+        if(fs->names[j] == NULL) break;
+        nn_size_t home = fs->names[j]->hash & mask;
+        nn_bool_t between = i <= j ? (i < home && home <= j) : (i < home || home <= j);
+        if(between) continue;
+        fs->names[i] = fs->names[j];
+        i = j;
+    }
+    fs->names[i] = NULL;
+    fs->nameCount--;
+    nn_dealloc(&fs->ctx.allocator, name, sizeof(nni_vfname) + name->len + 1);
+}
+
+// node pool
+
+static nn_vfnode *nni_vf_takeNode(nn_vfilesystem *fs, const char *name) {
+    if(fs->freeNodes == NULL) {
+        nni_vfslab *slab = nn_alloc(&fs->ctx.allocator, sizeof(nni_vfslab));
+        if(slab == NULL) return NULL;
+        slab->next = fs->slabs;
+        fs->slabs = slab;
+        for(nn_size_t i = 0; i < NNI_VF_SLAB_SIZE; i++) {
+            slab->nodes[i].parent = fs->freeNodes;
+            fs->freeNodes = slab->nodes + i;
+        }
+    }
+    nni_vfname *interned = nni_vf_intern(fs, name);
+    if(interned == NULL) return NULL;
+    nn_vfnode *node = fs->freeNodes;
+    fs->freeNodes = node->parent;
+    fs->nodesUsed++;
     *node = (nn_vfnode) {
         .fs = fs,
+        .name = interned,
         .lastModified = nn_vf_now(fs),
         .parent = NULL,
-        .isDirectory = false,
-        .data = NULL,
         .len = 0,
         .cap = 0,
+        .index = NULL,
+        .indexCap = 0,
         .handleCount = 0,
     };
-    // we pray
-    nn_strcpy(node->name, name);
+    return node;
+}
+
+static void nni_vf_giveNode(nn_vfnode *node) {
+    nn_vfilesystem *fs = node->fs;
+    nni_vf_releaseName(fs, node->name);
+    if(!node->isDirectory) fs->bytesUsed -= node->len;
+    fs->nodesUsed--;
+    node->parent = fs->freeNodes;
+    fs->freeNodes = node;
+}
+
+nn_vfnode *nn_vf_allocFile(nn_vfilesystem *fs, const char *name) {
+    nn_vfnode *node = nni_vf_takeNode(fs, name);
+    if(node == NULL) return NULL;
+    node->isDirectory = false;
+    node->data = NULL;
     return node;
 }
 
 nn_vfnode *nn_vf_allocDirectory(nn_vfilesystem *fs, const char *name) {
-    nn_Alloc *alloc = &fs->ctx.allocator;
-    nn_vfnode *node = nn_alloc(alloc, sizeof(nn_vfnode));
+    nn_vfnode *node = nni_vf_takeNode(fs, name);
     if(node == NULL) return NULL;
-    nn_vfnode **buffer = nn_alloc(alloc, sizeof(nn_vfnode *) * fs->opts.maxDirEntries);
-    if(buffer == NULL) {
-        nn_dealloc(alloc, node, sizeof(nn_vfnode));
-        return NULL;
-    }
-    *node = (nn_vfnode) {
-        .fs = fs,
-        .lastModified = nn_vf_now(fs),
-        .parent = NULL,
-        .isDirectory = true,
-        .entries = buffer,
-        .len = 0,
-        .cap = fs->opts.maxDirEntries,
-        .handleCount = 0,
-    };
-    // we pray
-    nn_strcpy(node->name, name);
+    node->isDirectory = true;
+    node->entries = NULL;
     return node;
 }
 
@@ -100,43 +249,89 @@ void nn_vf_freeNode(nn_vfnode *node) {
             nn_vf_freeNode(node->entries[i]);
         }
         nn_dealloc(alloc, node->entries, sizeof(nn_vfnode *) * node->cap);
-    } else {
+        nn_dealloc(alloc, node->index, sizeof(nn_size_t) * node->indexCap);
+    } else if(node->cap != 0) {
         nn_dealloc(alloc, node->data, node->cap);
     }
 
-    nn_dealloc(alloc, node, sizeof(nn_vfnode));
+    nni_vf_giveNode(node);
 }
 
-nn_size_t nn_vf_spaceUsedByNode(nn_vfnode *node) {
-    if(node->isDirectory) {
-        nn_size_t sum = 0;
-        for(nn_size_t i = 0; i < node->len; i++) {
-            sum += nn_vf_spaceUsedByNode(node->entries[i]);
-        }
-        return sum;
-    } else {
-        return node->len;
+static void nni_vf_indexInsert(nn_vfnode *dir, nn_size_t entryIdx) {
+    nn_size_t mask = dir->indexCap - 1;
+    nn_size_t i = dir->entries[entryIdx]->name->hash & mask;
+    while(dir->index[i] != 0) i = (i + 1) & mask;
+    dir->index[i] = entryIdx + 1;
+}
+
+// (re)builds the index from scratch, or drops it if the directory is small
+static void nni_vf_rebuildIndex(nn_vfnode *dir) {
+    nn_Alloc *alloc = &dir->fs->ctx.allocator;
+    if(dir->len < NNI_VF_INDEX_MIN) {
+        nn_dealloc(alloc, dir->index, sizeof(nn_size_t) * dir->indexCap);
+        dir->index = NULL;
+        dir->indexCap = 0;
+        return;
+    }
+    // at most half full
+    nn_size_t cap = dir->indexCap == 0 ? NNI_VF_INDEX_MIN * 2 : dir->indexCap;
+    while(cap < dir->len * 2) cap *= 2;
+    if(cap != dir->indexCap) {
+        nn_size_t *index = nn_alloc(alloc, sizeof(nn_size_t) * cap);
+        nn_dealloc(alloc, dir->index, sizeof(nn_size_t) * dir->indexCap);
+        dir->index = index;
+        dir->indexCap = index == NULL ? 0 : cap;
+        // we just fall back to scanning
+        if(index == NULL) return;
+    }
+    nn_memset(dir->index, 0, sizeof(nn_size_t) * dir->indexCap);
+    for(nn_size_t i = 0; i < dir->len; i++) {
+        nni_vf_indexInsert(dir, i);
     }
 }
 
-nn_vfnode *nn_vf_find(nn_vfnode *parent, const char *name) {
+// name does not need to be NULL-terminated
+nn_vfnode *nn_vf_findN(nn_vfnode *parent, const char *name, nn_size_t len) {
     if(!parent->isDirectory) return NULL;
+    unsigned int hash = nn_memhash(name, len);
+    // if nobody has that name, nobody in here has it either
+    nni_vfname *interned = nni_vf_lookupName(parent->fs, name, len, hash, NULL);
+    if(interned == NULL) return NULL;
+    if(parent->index != NULL) {
+        nn_size_t mask = parent->indexCap - 1;
+        for(nn_size_t i = hash & mask; parent->index[i] != 0; i = (i + 1) & mask) {
+            nn_vfnode *entry = parent->entries[parent->index[i] - 1];
+            if(entry->name == interned) return entry;
+        }
+        return NULL;
+    }
     for(nn_size_t i = 0; i < parent->len; i++) {
         nn_vfnode *entry = parent->entries[i];
-
-        if(nn_strcmp(entry->name, name) == 0) {
-            return entry;
-        }
+        if(entry->name == interned) return entry;
     }
     return NULL;
 }
 
+nn_vfnode *nn_vf_find(nn_vfnode *parent, const char *name) {
+    return nn_vf_findN(parent, name, nn_strlen(name));
+}
+
 nn_bool_t nn_vf_ensureFileCapacity(nn_vfnode *file, nn_size_t capacity) {
     if(file->isDirectory) return false;
     nn_Alloc *alloc = &file->fs->ctx.allocator;
 
     if(file->cap >= capacity) return true; // already at that point
 
+    if(file->cap == 0 && file->data != NULL) {
+        // still borrowed from the image, so we get our own copy
+        char *own = nn_alloc(alloc, capacity);
+        if(own == NULL) return false;
+        nn_memcpy(own, file->data, file->len);
+        file->data = own;
+        file->cap = capacity;
+        return true;
+    }
+
     char *newData = nn_resize(alloc, file->data, file->cap, capacity);
     if(newData == NULL) {
         return false; // OOM
@@ -167,20 +362,18 @@ void nn_vf_clampHandlePosition(nn_vfhandle *handle) {
     if(handle->position > len) handle->position = len;
 }
 
+// walks the path in place, 1 name at a time
 nn_vfnode *nn_vf_resolvePathFromNode(nn_vfnode *node, const char *path) {
-    if(path[0] == 0) {
-        return node;
-    }
-    char firstDirectory[NN_MAX_PATH];
-    char subpath[NN_MAX_PATH];
-    if(nn_path_firstName(path, firstDirectory, subpath)) {
-        return nn_vf_find(node, firstDirectory);
+    while(true) {
+        while(*path == '/') path++;
+        if(*path == '\0') return node;
+        if(!node->isDirectory) return NULL;
+        nn_size_t len = 0;
+        while(path[len] != '\0' && path[len] != '/') len++;
+        node = nn_vf_findN(node, path, len);
+        if(node == NULL) return NULL;
+        path += len;
     }
-
-    nn_vfnode *dir = nn_vf_find(node, firstDirectory);
-    if(dir == NULL) return NULL;
-    if(!dir->isDirectory) return NULL;
-    return nn_vf_resolvePathFromNode(dir, subpath);
 }
 
 nn_vfnode *nn_vf_resolvePath(nn_vfilesystem *fs, const char *path) {
@@ -204,12 +397,28 @@ nn_bool_t nn_vf_treeHasHandles(nn_vfnode *node) {
     return false;
 }
 
-void nn_vf_appendNode(nn_vfnode *parent, nn_vfnode *node) {
-    if(!parent->isDirectory) return;
-    if(parent->len == parent->cap) return;
+// returns false if the directory is full or we're out of memory
+nn_bool_t nn_vf_appendNode(nn_vfnode *parent, nn_vfnode *node) {
+    if(!parent->isDirectory) return false;
+    nn_size_t maxEntries = parent->fs->opts.maxDirEntries;
+    if(parent->len >= maxEntries) return false;
+    if(parent->len == parent->cap) {
+        nn_size_t cap = parent->cap == 0 ? 4 : parent->cap * 2;
+        if(cap > maxEntries) cap = maxEntries;
+        nn_vfnode **entries = nn_resize(&parent->fs->ctx.allocator, parent->entries, sizeof(nn_vfnode *) * parent->cap, sizeof(nn_vfnode *) * cap);
+        if(entries == NULL) return false;
+        parent->entries = entries;
+        parent->cap = cap;
+    }
     parent->entries[parent->len] = node;
     parent->len++;
     node->parent = parent; // just to be sure
+    if(parent->index != NULL && parent->len * 2 <= parent->indexCap) {
+        nni_vf_indexInsert(parent, parent->len - 1);
+    } else if(parent->len >= NNI_VF_INDEX_MIN) {
+        nni_vf_rebuildIndex(parent);
+    }
+    return true;
 }
 
 void nn_vf_removeNode(nn_vfnode *parent, nn_vfnode *node) {
@@ -222,6 +431,8 @@ void nn_vf_removeNode(nn_vfnode *parent, nn_vfnode *node) {
         }
     }
     parent->len = j;
+    // everything after it shifted, so the index is stale
+    if(parent->index != NULL) nni_vf_rebuildIndex(parent);
 }
 
 // methods
@@ -230,6 +441,14 @@ void nn_vfs_deinit(nn_vfilesystem *fs) {
     nn_Context ctx = fs->ctx;
 
     nn_vf_freeNode(fs->root);
+    while(fs->slabs != NULL) {
+        nni_vfslab *next = fs->slabs->next;
+        nn_dealloc(&ctx.allocator, fs->slabs, sizeof(nni_vfslab));
+        fs->slabs = next;
+    }
+    // every name is released by now
+    nn_dealloc(&ctx.allocator, fs->names, sizeof(nni_vfname *) * fs->nameCap);
+    if(fs->image != NULL) nn_destroyFsImage(fs->image);
     nn_dealloc(&ctx.allocator, fs, sizeof(nn_vfilesystem));
 }
 
@@ -244,7 +463,11 @@ void nn_vfs_setLabel(nn_vfilesystem *fs, const char *buf, nn_size_t buflen, nn_e
 }
 
 nn_size_t nn_vfs_spaceUsed(nn_vfilesystem *fs) {
-    return nn_vf_spaceUsedByNode(fs->root);
+    return fs->bytesUsed;
+}
+
+nn_size_t nn_vfs_nodesUsed(nn_vfilesystem *fs) {
+    return fs->nodesUsed;
 }
 
 nn_bool_t nn_vfs_isReadOnly(nn_vfilesystem *fs, nn_errorbuf_t err) {
@@ -330,14 +553,19 @@ nn_size_t nn_vfs_rename(nn_vfilesystem *fs, const char *from, const char *to, nn
         return 0;
     }
 
-    if(destParent->len == destParent->cap) {
+    if(destParent->len >= fs->opts.maxDirEntries) {
         nn_error_write(err, "Too many entries");
         return 0;
     }
     nn_size_t moved = nn_vf_countTree(srcNode);
     // super efficient moving
     nn_vf_removeNode(srcParent, srcNode);
-    nn_vf_appendNode(destParent, srcNode);
+    if(!nn_vf_appendNode(destParent, srcNode)) {
+        // it just left, so there's room for it to come back
+        nn_vf_appendNode(srcParent, srcNode);
+        nn_error_write(err, "Out of memory");
+        return 0;
+    }
     return moved;
 }
 
@@ -379,7 +607,7 @@ static nn_bool_t nn_vfs_recursiveMkdir(nn_vfilesystem *fs, const char *path, nn_
         nn_error_write(err, "Bad state"); // just a sanity check
         return false;
     }
-    if(parent->len == parent->cap) {
+    if(parent->len >= fs->opts.maxDirEntries) {
         nn_error_write(err, "Too many entries");
         return false;
     }
@@ -388,9 +616,11 @@ static nn_bool_t nn_vfs_recursiveMkdir(nn_vfilesystem *fs, const char *path, nn_
         nn_error_write(err, "Out of memory");
         return false;
     }
-    dir->parent = parent;
-    parent->entries[parent->len] = dir;
-    parent->len++;
+    if(!nn_vf_appendNode(parent, dir)) {
+        nn_vf_freeNode(dir);
+        nn_error_write(err, "Out of memory");
+        return false;
+    }
     return true;
 }
 
@@ -419,15 +649,15 @@ char **nn_vfs_list(nn_Alloc *alloc, nn_vfilesystem *fs, const char *path, nn_siz
         nn_vfnode *entry = node->entries[i];
         char *s = NULL;
         if(entry->isDirectory) {
-            nn_size_t l = nn_strlen(entry->name);
+            nn_size_t l = entry->name->len;
             s = nn_alloc(alloc, l + 2);
             if(s != NULL) {
-                nn_memcpy(s, entry->name, l);
+                nn_memcpy(s, entry->name->data, l);
                 s[l] = '/';
                 s[l+1] = 0;
             }
         } else {
-            s = nn_strdup(alloc, entry->name);
+            s = nn_strdup(alloc, entry->name->data);
         }
         if(s == NULL) {
             for(nn_size_t j = 0; j < i; j++) {
@@ -464,7 +694,7 @@ nn_vfhandle *nn_vfs_open(nn_vfilesystem *fs, const char *path, const char *mode,
             return NULL;
         }
 
-        if(parent->len == parent->cap) {
+        if(parent->len >= fs->opts.maxDirEntries) {
             nn_error_write(err, "Too many entries");
             return NULL;
         }
@@ -474,10 +704,11 @@ nn_vfhandle *nn_vfs_open(nn_vfilesystem *fs, const char *path, const char *mode,
             nn_error_write(err, "Out of memory");
             return NULL;
         }
-        node->parent = parent;
-
-        parent->entries[parent->len] = node;
-        parent->len++;
+        if(!nn_vf_appendNode(parent, node)) {
+            nn_vf_freeNode(node);
+            nn_error_write(err, "Out of memory");
+            return NULL;
+        }
     }
     if(node == NULL) {
         nn_error_write(err, "No such file");
@@ -492,6 +723,7 @@ nn_vfhandle *nn_vfs_open(nn_vfilesystem *fs, const char *path, const char *mode,
         return NULL;
     }
     if(fmode == NN_VFMODE_WRITE) {
+        fs->bytesUsed -= node->len;
         node->len = 0;
         node->lastModified = nn_vf_now(fs);
     }
@@ -521,7 +753,10 @@ nn_bool_t nn_vfs_write(nn_vfilesystem *fs, nn_vfhandle *handle, const char *buf,
     }
     nn_memcpy(handle->node->data + handle->position, buf, len);
     handle->position += len;
-    if(handle->node->len < handle->position) handle->node->len = handle->position;
+    if(handle->node->len < handle->position) {
+        fs->bytesUsed += handle->position - handle->node->len;
+        handle->node->len = handle->position;
+    }
     return true;
 }
 
@@ -534,6 +769,20 @@ nn_size_t nn_vfs_read(nn_vfilesystem *fs, nn_vfhandle *handle, char *buf, nn_siz
     return required;
 }
 
+nn_value nn_vfs_readValue(nn_Alloc *alloc, nn_vfilesystem *fs, nn_vfhandle *handle, nn_size_t required, nn_errorbuf_t err) {
+    nn_size_t remaining = handle->node->len - handle->position;
+    if(required > remaining) required = remaining;
+    if(required == 0) return nn_values_nil();
+    // we know exactly how much there is, so 1 allocation, 1 copy
+    nn_value val = nn_values_string(alloc, handle->node->data + handle->position, required);
+    if(val.tag == NN_VALUE_NIL) {
+        nn_error_write(err, "Out of memory");
+        return val;
+    }
+    handle->position += required;
+    return val;
+}
+
 nn_size_t nn_vfs_seek(nn_vfilesystem *fs, nn_vfhandle *handle, const char *whence, int off, nn_errorbuf_t err) {
     if(handle->mode == NN_VFMODE_APPEND) {
         nn_error_write(err, "Bad file descriptor");
@@ -565,24 +814,32 @@ static nn_vfilesystemImageNode nni_vfsimg_nextNode(nn_vfilesystemImage *stream)
 	return node;
 }
 
-static nn_vfnode *nni_vfsimg_parseNode(nn_vfilesystem *fs, nn_vfilesystemImage *stream, nn_vfnode *parent) {
+static nn_vfnode *nni_vfsimg_parseNode(nn_vfilesystem *fs, nn_vfilesystemImage *stream, nn_vfnode *parent, nn_bool_t borrow) {
 	// TODO: make this handle OOMs
 	nn_vfilesystemImageNode node = nni_vfsimg_nextNode(stream);
 	if(node.data == NULL) {
 		// directory!!!!!
 		nn_vfnode *dir = nn_vf_allocDirectory(fs, node.name);
-		dir->len = node.len;
 		dir->parent = parent;
 		for(int i = 0; i < node.len; i++) {
-			nn_vfnode *entry = nni_vfsimg_parseNode(fs, stream, dir);
-			dir->entries[i] = entry;
+			nn_vfnode *entry = nni_vfsimg_parseNode(fs, stream, dir, borrow);
+			if(!nn_vf_appendNode(dir, entry)) nn_vf_freeNode(entry);
 		}
 		return dir;
 	}
 	// file!!!!!
 	nn_vfnode *file = nn_vf_allocFile(fs, node.name);
+	if(borrow) {
+		// copy on write, see nn_vf_ensureFileCapacity()
+		file->data = (char *)node.data;
+		file->len = node.len;
+		fs->bytesUsed += node.len;
+		file->parent = parent;
+		return file;
+	}
 	nn_vf_ensureFileCapacity(file, node.len);
 	file->len = node.len;
+	fs->bytesUsed += node.len;
 	file->parent = parent;
 	nn_memcpy(file->data, node.data, node.len);
 	return file;
@@ -590,7 +847,8 @@ static nn_vfnode *nni_vfsimg_parseNode(nn_vfilesystem *fs, nn_vfilesystemImage *
 
 // constructor
 
-nn_filesystem *nn_volatileFilesystem(nn_Context *context, nn_vfilesystemOptions opts, nn_filesystemControl control) {
+// if image is not NULL, the files borrow from it instead of opts.image
+static nn_filesystem *nni_vfs_new(nn_Context *context, nn_vfilesystemOptions opts, nn_fsImage *image, nn_filesystemControl control) {
     // TODO: handle OOM
     nn_vfilesystem *fs = nn_alloc(&context->allocator, sizeof(nn_vfilesystem));
     fs->ctx = *context;
@@ -598,20 +856,36 @@ nn_filesystem *nn_volatileFilesystem(nn_Context *context, nn_vfilesystemOptions
     double time = c.proc(c.userdata);
     fs->birthday = time;
     fs->opts = opts;
+    fs->slabs = NULL;
+    fs->freeNodes = NULL;
+    fs->bytesUsed = 0;
+    fs->nodesUsed = 0;
+    fs->nameCap = 16;
+    fs->nameCount = 0;
+    fs->names = nn_alloc(&context->allocator, sizeof(nni_vfname *) * fs->nameCap);
+    for(nn_size_t i = 0; i < fs->nameCap; i++) fs->names[i] = NULL;
     fs->root = nn_vf_allocDirectory(fs, "/");
+    fs->image = image;
 
-	if(opts.image != NULL) {
+    if(image != NULL) {
+        nn_retainFsImage(image);
+        fs->opts.image = image->nodes;
+        fs->opts.rootEntriesInImage = image->rootEntries;
+    }
+
+	if(fs->opts.image != NULL) {
 		nn_vfilesystemImage stream = {
-			.nodes = opts.image,
+			.nodes = fs->opts.image,
 			.ptr = 0,
 		};
 		// we got supplied an image, shit
-		fs->root->len = opts.rootEntriesInImage;
-		for(int i = 0; i < opts.rootEntriesInImage; i++) {
-			nn_vfnode *entry = nni_vfsimg_parseNode(fs, &stream, fs->root);
-			fs->root->entries[i] = entry;
+		for(int i = 0; i < fs->opts.rootEntriesInImage; i++) {
+			nn_vfnode *entry = nni_vfsimg_parseNode(fs, &stream, fs->root, image != NULL);
+			if(!nn_vf_appendNode(fs->root, entry)) nn_vf_freeNode(entry);
 		}
 	}
+    // opts.image is only borrowed for the duration of the constructor
+    fs->opts.image = NULL;
 
     nn_filesystemTable table = {
         .userdata = fs,
@@ -619,6 +893,8 @@ nn_filesystem *nn_volatileFilesystem(nn_Context *context, nn_vfilesystemOptions
         .getLabel = (void *)nn_vfs_getLabel,
         .setLabel = (void *)nn_vfs_setLabel,
         .spaceUsed = (void *)nn_vfs_spaceUsed,
+        .spaceUsedIsCounted = true,
+        .nodesUsed = (void *)nn_vfs_nodesUsed,
         .spaceTotal = opts.capacity,
         .isReadOnly = (void *)nn_vfs_isReadOnly,
         .size = (void *)nn_vfs_size,
@@ -633,7 +909,93 @@ nn_filesystem *nn_volatileFilesystem(nn_Context *context, nn_vfilesystemOptions
         .close = (void *)nn_vfs_close,
         .write = (void *)nn_vfs_write,
         .read = (void *)nn_vfs_read,
+        .readValue = (void *)nn_vfs_readValue,
         .seek = (void *)nn_vfs_seek,
     };
     return nn_newFilesystem(context, table, control);
 }
+
+nn_filesystem *nn_volatileFilesystem(nn_Context *context, nn_vfilesystemOptions opts, nn_filesystemControl control) {
+    return nni_vfs_new(context, opts, NULL, control);
+}
+
+nn_filesystem *nn_overlayFilesystem(nn_Context *context, nn_vfilesystemOptions opts, nn_fsImage *image, nn_filesystemControl control) {
+    return nni_vfs_new(context, opts, image, control);
+}
+
+// shared images
+
+// counts the nodes and the bytes needed to store the names and files of a subtree
+static void nni_fsimg_measure(nn_vfilesystemImage *stream, nn_size_t *blobSize) {
+	nn_vfilesystemImageNode node = nni_vfsimg_nextNode(stream);
+	*blobSize += nn_strlen(node.name) + 1;
+	if(node.data != NULL) {
+		*blobSize += node.len;
+		return;
+	}
+	for(nn_size_t i = 0; i < node.len; i++) {
+		nni_fsimg_measure(stream, blobSize);
+	}
+}
+
+nn_fsImage *nn_newFsImage(nn_Context *context, nn_vfilesystemImageNode *nodes, nn_size_t rootEntries) {
+	nn_Alloc *alloc = &context->allocator;
+
+	nn_vfilesystemImage stream = {
+		.nodes = nodes,
+		.ptr = 0,
+	};
+	nn_size_t blobSize = 0;
+	for(nn_size_t i = 0; i < rootEntries; i++) {
+		nni_fsimg_measure(&stream, &blobSize);
+	}
+	nn_size_t nodeCount = stream.ptr;
+
+	nn_fsImage *image = nn_alloc(alloc, sizeof(nn_fsImage));
+	if(image == NULL) return NULL;
+	image->nodes = nn_alloc(alloc, sizeof(nn_vfilesystemImageNode) * nodeCount);
+	if(image->nodes == NULL) {
+		nn_dealloc(alloc, image, sizeof(nn_fsImage));
+		return NULL;
+	}
+	image->blob = nn_alloc(alloc, blobSize);
+	if(image->blob == NULL) {
+		nn_dealloc(alloc, image->nodes, sizeof(nn_vfilesystemImageNode) * nodeCount);
+		nn_dealloc(alloc, image, sizeof(nn_fsImage));
+		return NULL;
+	}
+	image->ctx = *context;
+	image->refc = 1;
+	image->nodeCount = nodeCount;
+	image->rootEntries = rootEntries;
+	image->blobSize = blobSize;
+
+	char *cursor = image->blob;
+	for(nn_size_t i = 0; i < nodeCount; i++) {
+		nn_vfilesystemImageNode node = nodes[i];
+		nn_size_t nameLen = nn_strlen(node.name);
+		nn_memcpy(cursor, node.name, nameLen + 1);
+		node.name = cursor;
+		cursor += nameLen + 1;
+		if(node.data != NULL) {
+			nn_memcpy(cursor, node.data, node.len);
+			node.data = cursor;
+			cursor += node.len;
+		}
+		image->nodes[i] = node;
+	}
+	return image;
+}
+
+void nn_retainFsImage(nn_fsImage *image) {
+	nn_incRef(&image->refc);
+}
+
+nn_bool_t nn_destroyFsImage(nn_fsImage *image) {
+	if(!nn_decRef(&image->refc)) return false;
+	nn_Alloc *alloc = &image->ctx.allocator;
+	nn_dealloc(alloc, image->blob, image->blobSize);
+	nn_dealloc(alloc, image->nodes, sizeof(nn_vfilesystemImageNode) * image->nodeCount);
+	nn_dealloc(alloc, image, sizeof(nn_fsImage));
+	return true;
+}
@@ -4,6 +4,10 @@
 #include "neonucleus.h"
 #include "resource.h"
 
+#ifndef NN_BAREMETAL
+#include <stdatomic.h>
+#endif
+
 nn_computer *nn_newComputer(nn_universe *universe, nn_address address, nn_architecture *arch, void *userdata, nn_size_t memoryLimit, nn_size_t componentLimit) {
     nn_Alloc *alloc = &universe->ctx.allocator;
     nn_computer *c = nn_alloc(alloc, sizeof(nn_computer));
@@ -12,15 +16,40 @@ nn_computer *nn_newComputer(nn_universe *universe, nn_address address, nn_archit
         nn_dealloc(alloc, c, sizeof(nn_computer));
         return NULL;
     }
+    for(nn_size_t i = 0; i < componentLimit; i++) {
+        c->components[i].generation = 0;
+    }
+    // at most half full
+    c->componentIndexCap = 4;
+    while(c->componentIndexCap < componentLimit * 2) c->componentIndexCap *= 2;
+    c->componentIndex = nn_alloc(alloc, sizeof(nn_size_t) * c->componentIndexCap);
+    if(c->componentIndex == NULL) {
+        nn_dealloc(alloc, c->components, sizeof(nn_component) * componentLimit);
+        nn_dealloc(alloc, c, sizeof(nn_computer));
+        return NULL;
+    }
+    nn_memset(c->componentIndex, 0, sizeof(nn_size_t) * c->componentIndexCap);
     c->address = nn_strdup(alloc, address);
     if(c->address == NULL) {
+        nn_dealloc(alloc, c->componentIndex, sizeof(nn_size_t) * c->componentIndexCap);
+        nn_dealloc(alloc, c->components, sizeof(nn_component) * componentLimit);
+        nn_dealloc(alloc, c, sizeof(nn_computer));
+        return NULL;
+    }
+    c->callArena = nn_newArena(alloc, NNI_CALL_ARENA_CHUNK);
+    if(c->callArena == NULL) {
+        nn_deallocStr(alloc, c->address);
+        nn_dealloc(alloc, c->componentIndex, sizeof(nn_size_t) * c->componentIndexCap);
         nn_dealloc(alloc, c->components, sizeof(nn_component) * componentLimit);
         nn_dealloc(alloc, c, sizeof(nn_computer));
         return NULL;
     }
+    c->callAlloc = nn_arena_allocator(c->callArena);
     c->lock = nn_newGuard(&universe->ctx);
     if(c->lock == NULL) {
+        nn_destroyArena(c->callArena);
         nn_deallocStr(alloc, c->address);
+        nn_dealloc(alloc, c->componentIndex, sizeof(nn_size_t) * c->componentIndexCap);
         nn_dealloc(alloc, c->components, sizeof(nn_component) * componentLimit);
         nn_dealloc(alloc, c, sizeof(nn_computer));
         return NULL;
@@ -38,7 +67,15 @@ nn_computer *nn_newComputer(nn_universe *universe, nn_address address, nn_archit
     c->componentCap = componentLimit;
     c->userCount = 0;
     c->maxEnergy = 5000;
+    c->signals = NULL;
+    c->signalCap = 0;
+    c->signalHead = 0;
     c->signalCount = 0;
+    c->inbox = NULL;
+    c->inboxLen = 0;
+    c->wakeRequested = false;
+    c->sleeping = false;
+    c->sleepUntil = 0;
     c->universe = universe;
     c->arch = arch;
     c->nextArch = arch;
@@ -55,7 +92,9 @@ nn_computer *nn_newComputer(nn_universe *universe, nn_address address, nn_archit
     c->archState = c->arch->setup(c, c->arch->userdata);
     if(c->archState == NULL) {
         nn_deleteGuard(&universe->ctx, c->lock);
+        nn_destroyArena(c->callArena);
         nn_deallocStr(alloc, c->address);
+        nn_dealloc(alloc, c->componentIndex, sizeof(nn_size_t) * c->componentIndexCap);
         nn_dealloc(alloc, c->components, sizeof(nn_component) * componentLimit);
         nn_dealloc(alloc, c, sizeof(nn_computer));
         return NULL;
@@ -67,6 +106,10 @@ nn_computer *nn_newComputer(nn_universe *universe, nn_address address, nn_archit
 	}
 
 	c->hasBeep = false;
+	c->scheduled = false;
+	c->scheduleIdx = 0;
+	c->removeLater = false;
+	c->deleteLater = false;
 
     return c;
 }
@@ -88,7 +131,28 @@ nn_address nn_getTmpAddress(nn_computer *computer) {
     return computer->tmpAddress;
 }
 
+static void nni_drainInbox(nn_computer *computer);
+
 int nn_tickComputer(nn_computer *computer) {
+    if(computer->state == NN_STATE_DORMANT) {
+#ifdef NN_BAREMETAL
+        nn_bool_t wake = computer->wakeRequested;
+        computer->wakeRequested = false;
+#else
+        nn_bool_t wake = atomic_exchange_explicit(&computer->wakeRequested, false, memory_order_relaxed);
+#endif
+        // nobody is listening, so whatever was sent while we slept is gone
+        nni_drainInbox(computer);
+        while(computer->signalCount > 0) {
+            nn_popSignal(computer);
+        }
+        if(!wake || !nn_wakeComputer(computer)) return NN_STATE_DORMANT;
+    }
+    nni_drainInbox(computer);
+    if(computer->sleeping) {
+        if(nn_isComputerSleeping(computer)) return nn_getState(computer);
+        computer->sleeping = false;
+    }
     computer->callCost = 0;
     computer->state = NN_STATE_RUNNING;
     nn_clearError(computer);
@@ -96,11 +160,73 @@ int nn_tickComputer(nn_computer *computer) {
     return nn_getState(computer);
 }
 
+static void nni_releaseResources(nn_computer *computer) {
+	for(nn_size_t i = 0; i < NN_MAX_CONCURRENT_RESOURCES; i++) {
+		if(computer->resources[i].id != NN_NULL_RESOURCE) {
+			nn_resource_release(computer, computer->resources[i].id);
+		}
+	}
+}
+
+void nn_makeComputerDormant(nn_computer *computer) {
+    if(computer->state == NN_STATE_DORMANT) return;
+    nn_clearError(computer);
+    nn_resetCall(computer);
+    while(computer->signalCount > 0) {
+        nn_popSignal(computer);
+    }
+    nni_releaseResources(computer);
+    computer->arch->teardown(computer, computer->archState, computer->arch->userdata);
+    computer->archState = NULL;
+    computer->state = NN_STATE_DORMANT;
+    computer->sleeping = false;
+    // a request from while it was running doesn't count
+    computer->wakeRequested = false;
+    nni_network_setDormant(computer->universe->network, computer, true);
+}
+
+nn_bool_t nn_isComputerDormant(nn_computer *computer) {
+    return computer->state == NN_STATE_DORMANT;
+}
+
+nn_bool_t nn_wakeComputer(nn_computer *computer) {
+    if(computer->state != NN_STATE_DORMANT) return true;
+    void *archState = computer->arch->setup(computer, computer->arch->userdata);
+    if(archState == NULL) return false;
+    computer->archState = archState;
+    computer->timeOffset = nn_getTime(computer->universe);
+    computer->state = NN_STATE_SETUP;
+    nni_network_setDormant(computer->universe->network, computer, false);
+    return true;
+}
+
+void nn_sleepComputer(nn_computer *computer, double timeout) {
+    computer->sleeping = true;
+    computer->sleepUntil = nn_getTime(computer->universe) + timeout;
+}
+
+nn_bool_t nn_isComputerSleeping(nn_computer *computer) {
+    if(!computer->sleeping) return false;
+    if(computer->signalCount > 0) return false;
+    // posted but not drained yet
+    if(computer->inbox != NULL) return false;
+    return nn_getTime(computer->universe) < computer->sleepUntil;
+}
+
+void nn_requestComputerWake(nn_computer *computer) {
+#ifdef NN_BAREMETAL
+    computer->wakeRequested = true;
+#else
+    atomic_store_explicit(&computer->wakeRequested, true, memory_order_relaxed);
+#endif
+}
+
 double nn_getUptime(nn_computer *computer) {
     return nn_getTime(computer->universe) - computer->timeOffset;
 }
 
 nn_size_t nn_getComputerMemoryUsed(nn_computer *computer) {
+    if(computer->archState == NULL) return 0;
     return computer->arch->getMemoryUsage(computer, computer->archState, computer->arch->userdata);
 }
 
@@ -136,65 +262,225 @@ void nn_setNextArchitecture(nn_computer *computer, nn_architecture *arch) {
 }
 
 void nn_deleteComputer(nn_computer *computer) {
+    if(computer->universe->ticking && computer->scheduled) {
+        // a worker may still be holding our lock, nn_universe_tickAll() deletes us once they're all done
+        computer->deleteLater = true;
+        return;
+    }
+    nn_universe_removeComputer(computer->universe, computer);
+    // before draining, so nothing is posted to us once we're freed
+    nni_network_forgetComputer(computer->universe->network, computer);
     nn_clearError(computer);
     nn_resetCall(computer);
+    nni_drainInbox(computer);
     while(computer->signalCount > 0) {
         nn_popSignal(computer);
     }
     nn_Alloc *a = &computer->universe->ctx.allocator;
+    nn_dealloc(a, computer->signals, sizeof(nn_signal) * computer->signalCap);
     for(nn_size_t i = 0; i < computer->userCount; i++) {
         nn_deallocStr(a, computer->users[i]);
     }
-	for(nn_size_t i = 0; i < NN_MAX_CONCURRENT_RESOURCES; i++) {
-		if(computer->resources[i].id != NN_NULL_RESOURCE) {
-			nn_resource_release(computer, computer->resources[i].id);
-		}
-	}
-    computer->arch->teardown(computer, computer->archState, computer->arch->userdata);
+    nni_releaseResources(computer);
+    if(computer->archState != NULL) {
+        computer->arch->teardown(computer, computer->archState, computer->arch->userdata);
+    }
     nn_deleteGuard(&computer->universe->ctx, computer->lock);
+    nn_destroyArena(computer->callArena);
     nn_deallocStr(a, computer->address);
     nn_deallocStr(a, computer->tmpAddress);
+    nn_dealloc(a, computer->componentIndex, sizeof(nn_size_t) * computer->componentIndexCap);
     nn_dealloc(a, computer->components, sizeof(nn_component) * computer->componentCap);
     nn_dealloc(a, computer, sizeof(nn_computer));
 }
 
-const char *nn_pushSignal(nn_computer *computer, nn_value *values, nn_size_t len) {
+// how many values a signal holds itself, a packet holds the rest
+static nn_size_t nni_storedValues(nn_size_t len, nn_packet *packet) {
+    return packet != NULL ? NNI_PACKET_HEADER : len;
+}
+
+static nn_bool_t nni_growSignals(nn_computer *computer) {
+    nn_Alloc *a = &computer->universe->ctx.allocator;
+    nn_size_t cap = computer->signalCap * 2;
+    if(cap < 4) cap = 4;
+    if(cap > NN_MAX_SIGNALS) cap = NN_MAX_SIGNALS;
+    nn_signal *signals = nn_alloc(a, sizeof(nn_signal) * cap);
+    if(signals == NULL) return false;
+    // unwrap it while we're at it
+    for(nn_size_t i = 0; i < computer->signalCount; i++) {
+        nn_signal *src = computer->signals + (computer->signalHead + i) % computer->signalCap;
+        signals[i].len = src->len;
+        signals[i].packet = src->packet;
+        nn_memcpy(signals[i].values, src->values, sizeof(nn_value) * nni_storedValues(src->len, src->packet));
+    }
+    nn_dealloc(a, computer->signals, sizeof(nn_signal) * computer->signalCap);
+    computer->signals = signals;
+    computer->signalCap = cap;
+    computer->signalHead = 0;
+    return true;
+}
+
+static const char *nni_checkSignal(nn_value *values, nn_size_t len) {
     if(len > NN_MAX_SIGNAL_VALS) return "too many values";
     if(len == 0) return "missing event";
     // no OOM for you hehe
     if(nn_measurePacketSize(values, len) > NN_MAX_SIGNAL_SIZE) {
         return "too big";
     }
-    if(computer->signalCount == NN_MAX_SIGNALS) return "too many signals";
-    computer->signals[computer->signalCount].len = len;
+    return NULL;
+}
+
+static void nni_fillSignal(nn_value *dst, nn_value *values, nn_size_t len) {
     for(nn_size_t i = 0; i < len; i++) {
-        computer->signals[computer->signalCount].values[i] = values[i];
+        // signals outlive the call arena
+        dst[i] = nn_values_escape(values[i]);
+    }
+}
+
+static void nni_dropValues(nn_value *values, nn_size_t len, nn_packet *packet) {
+    nn_values_dropAll(values, nni_storedValues(len, packet));
+    if(packet != NULL) nn_dropPacket(packet);
+}
+
+static void nni_dropSignal(nn_signal *p) {
+    nni_dropValues(p->values, p->len, p->packet);
+}
+
+// the free slot at the back of the queue, NULL if there isn't one
+static nn_signal *nni_reserveSignal(nn_computer *computer, const char **err) {
+    if(computer->signalCount == NN_MAX_SIGNALS) {
+        *err = "too many signals";
+        return NULL;
+    }
+    if(computer->signalCount == computer->signalCap) {
+        if(!nni_growSignals(computer)) {
+            *err = "out of memory";
+            return NULL;
+        }
     }
+    return computer->signals + (computer->signalHead + computer->signalCount) % computer->signalCap;
+}
+
+const char *nn_pushSignal(nn_computer *computer, nn_value *values, nn_size_t len) {
+    const char *err = nni_checkSignal(values, len);
+    if(err != NULL) return err;
+    nn_signal *p = nni_reserveSignal(computer, &err);
+    if(p == NULL) return err;
+    p->len = len;
+    p->packet = NULL;
+    nni_fillSignal(p->values, values, len);
     computer->signalCount++;
     return NULL;
 }
 
+static nn_size_t nni_inboxNodeSize(nn_size_t len, nn_packet *packet) {
+    return sizeof(nni_inboxNode) + sizeof(nn_value) * nni_storedValues(len, packet);
+}
+
+static nni_inboxNode *nni_newInboxNode(nn_computer *computer, nn_size_t len, nn_packet *packet) {
+    nni_inboxNode *node = nn_alloc(&computer->universe->ctx.allocator, nni_inboxNodeSize(len, packet));
+    if(node == NULL) return NULL;
+    node->len = len;
+    node->packet = packet;
+    return node;
+}
+
+static void nni_freeInboxNode(nn_computer *computer, nni_inboxNode *node) {
+    nn_dealloc(&computer->universe->ctx.allocator, node, nni_inboxNodeSize(node->len, node->packet));
+}
+
+static void nni_postNode(nn_computer *computer, nni_inboxNode *node) {
+#ifdef NN_BAREMETAL
+    node->next = computer->inbox;
+    computer->inbox = node;
+    computer->inboxLen++;
+#else
+    atomic_fetch_add_explicit(&computer->inboxLen, 1, memory_order_relaxed);
+    nni_inboxNode *head = atomic_load_explicit(&computer->inbox, memory_order_relaxed);
+    do {
+        node->next = head;
+    } while(!atomic_compare_exchange_weak_explicit(&computer->inbox, &head, node, memory_order_release, memory_order_relaxed));
+#endif
+}
+
+static nn_bool_t nni_inboxFull(nn_computer *computer) {
+    // a rough limit, a computer that isn't ticked shouldn't eat all the memory
+    return computer->inboxLen >= NN_MAX_SIGNALS;
+}
+
+const char *nn_postSignal(nn_computer *computer, nn_value *values, nn_size_t len) {
+    const char *err = nni_checkSignal(values, len);
+    if(err != NULL) return err;
+    if(nni_inboxFull(computer)) return "too many signals";
+    nni_inboxNode *node = nni_newInboxNode(computer, len, NULL);
+    if(node == NULL) return "out of memory";
+    nni_fillSignal(node->values, values, len);
+    nni_postNode(computer, node);
+    return NULL;
+}
+
+static void nni_drainInbox(nn_computer *computer) {
+#ifdef NN_BAREMETAL
+    nni_inboxNode *node = computer->inbox;
+    computer->inbox = NULL;
+#else
+    // cheap check first, this runs every tick
+    if(atomic_load_explicit(&computer->inbox, memory_order_relaxed) == NULL) return;
+    nni_inboxNode *node = atomic_exchange_explicit(&computer->inbox, NULL, memory_order_acquire);
+#endif
+    // it's newest first, flip it
+    nni_inboxNode *fifo = NULL;
+    nn_size_t count = 0;
+    while(node != NULL) {
+        nni_inboxNode *next = node->next;
+        node->next = fifo;
+        fifo = node;
+        node = next;
+        count++;
+    }
+#ifdef NN_BAREMETAL
+    computer->inboxLen -= count;
+#else
+    atomic_fetch_sub_explicit(&computer->inboxLen, count, memory_order_relaxed);
+#endif
+    while(fifo != NULL) {
+        nni_inboxNode *next = fifo->next;
+        const char *err;
+        nn_signal *p = nni_reserveSignal(computer, &err);
+        if(p == NULL) {
+            // lost, same as if it was pushed
+            nni_dropValues(fifo->values, fifo->len, fifo->packet);
+        } else {
+            p->len = fifo->len;
+            p->packet = fifo->packet;
+            nn_memcpy(p->values, fifo->values, sizeof(nn_value) * nni_storedValues(fifo->len, fifo->packet));
+            computer->signalCount++;
+        }
+        nni_freeInboxNode(computer, fifo);
+        fifo = next;
+    }
+}
+
 nn_value nn_fetchSignalValue(nn_computer *computer, nn_size_t index) {
     if(computer->signalCount == 0) return nn_values_nil();
-    nn_signal *p = computer->signals;
+    nn_signal *p = computer->signals + computer->signalHead;
     if(index >= p->len) return nn_values_nil();
+    if(p->packet != NULL) {
+        if(index == 2) return p->packet->sender;
+        if(index >= NNI_PACKET_HEADER) return p->packet->values[index - NNI_PACKET_HEADER];
+    }
     return p->values[index];
 }
 
 nn_size_t nn_signalSize(nn_computer *computer) {
     if(computer->signalCount == 0) return 0;
-    return computer->signals[0].len;
+    return computer->signals[computer->signalHead].len;
 }
 
 void nn_popSignal(nn_computer *computer) {
     if(computer->signalCount == 0) return;
-    nn_signal *p = computer->signals;
-    for(nn_size_t i = 0; i < p->len; i++) {
-        nn_values_drop(p->values[i]);
-    }
-    for(nn_size_t i = 1; i < computer->signalCount; i++) {
-        computer->signals[i-1] = computer->signals[i];
-    }
+    nni_dropSignal(computer->signals + computer->signalHead);
+    computer->signalHead = (computer->signalHead + 1) % computer->signalCap;
     computer->signalCount--;
 }
 
@@ -368,6 +654,35 @@ void nn_setCError(nn_computer *computer, const char *err) {
     computer->allocatedError = false;
 }
 
+static void nni_componentIndex_insert(nn_computer *computer, nn_size_t idx) {
+    nn_size_t mask = computer->componentIndexCap - 1;
+    nn_size_t slot = computer->components[idx].addressHash & mask;
+    while(computer->componentIndex[slot] != 0) slot = (slot + 1) & mask;
+    computer->componentIndex[slot] = idx + 1;
+}
+
+static void nni_componentIndex_remove(nn_computer *computer, nn_size_t idx) {
+    nn_size_t mask = computer->componentIndexCap - 1;
+    nn_size_t slot = computer->components[idx].addressHash & mask;
+    while(computer->componentIndex[slot] != idx + 1) slot = (slot + 1) & mask;
+    computer->componentIndex[slot] = 0;
+
+    // backward shift deletion, so we never need tombstones
+    nn_size_t hole = slot;
+    slot = (slot + 1) & mask;
+    while(computer->componentIndex[slot] != 0) {
+        nn_size_t other = computer->componentIndex[slot] - 1;
+        nn_size_t home = computer->components[other].addressHash & mask;
+        // move it into the hole if the hole is between its home and where it is now
+        if(((slot - home) & mask) >= ((slot - hole) & mask)) {
+            computer->componentIndex[hole] = computer->componentIndex[slot];
+            computer->componentIndex[slot] = 0;
+            hole = slot;
+        }
+        slot = (slot + 1) & mask;
+    }
+}
+
 nn_component *nn_newComponent(nn_computer *computer, nn_address address, int slot, nn_componentTable *table, void *userdata) {
     nn_component *c = NULL;
     for(nn_size_t i = 0; i < computer->componentLen; i++) {
@@ -379,6 +694,7 @@ nn_component *nn_newComponent(nn_computer *computer, nn_address address, int slo
     if(c == NULL) {
         if(computer->componentLen == computer->componentCap) return NULL; // too many
         c = computer->components + computer->componentLen;
+        c->address = NULL;
         computer->componentLen++;
     }
 
@@ -388,6 +704,8 @@ nn_component *nn_newComponent(nn_computer *computer, nn_address address, int slo
         c->address = nn_strdup(&computer->universe->ctx.allocator, address);
     }
     if(c->address == NULL) return NULL;
+    c->addressHash = nn_strhash(c->address);
+    c->generation++;
     c->table = table;
     c->slot = slot;
     c->computer = computer;
@@ -396,19 +714,21 @@ nn_component *nn_newComponent(nn_computer *computer, nn_address address, int slo
     } else {
         c->statePtr = table->constructor(table->userdata, userdata);
     }
+    nni_componentIndex_insert(computer, c - computer->components);
     return c;
 }
 
 void nn_removeComponent(nn_computer *computer, nn_address address) {
-    for(nn_size_t i = 0; i < computer->componentLen; i++) {
-        if(nn_strcmp(computer->components[i].address, address) == 0) {
-            nn_destroyComponent(computer->components + i);
-        }
+    nn_component *c;
+    while((c = nn_findComponent(computer, address)) != NULL) {
+        nn_destroyComponent(c);
     }
 }
 
 void nn_destroyComponent(nn_component *component) {
-    nn_deallocStr(&component->computer->universe->ctx.allocator, component->address);
+    nn_computer *computer = component->computer;
+    nni_componentIndex_remove(computer, component - computer->components);
+    nn_deallocStr(&computer->universe->ctx.allocator, component->address);
     if(component->table->destructor != NULL) {
         component->table->destructor(component->table->userdata, component, component->statePtr);
     }
@@ -416,15 +736,36 @@ void nn_destroyComponent(nn_component *component) {
 }
 
 nn_component *nn_findComponent(nn_computer *computer, nn_address address) {
-    for(nn_size_t i = 0; i < computer->componentLen; i++) {
-        if(computer->components[i].address == NULL) continue; // empty slot
-        if(nn_strcmp(computer->components[i].address, address) == 0) {
-            return computer->components + i;
+    unsigned int hash = nn_strhash(address);
+    nn_size_t mask = computer->componentIndexCap - 1;
+    nn_size_t slot = hash & mask;
+    while(computer->componentIndex[slot] != 0) {
+        nn_component *c = computer->components + computer->componentIndex[slot] - 1;
+        if(c->addressHash == hash && nn_strcmp(c->address, address) == 0) {
+            return c;
         }
+        slot = (slot + 1) & mask;
     }
     return NULL;
 }
 
+nn_size_t nn_getComponentHandle(nn_component *component) {
+    nn_computer *computer = component->computer;
+    nn_size_t idx = component - computer->components;
+    return component->generation * computer->componentCap + idx;
+}
+
+nn_component *nn_resolveComponentHandle(nn_computer *computer, nn_size_t handle) {
+    if(computer->componentCap == 0) return NULL;
+    nn_size_t idx = handle % computer->componentCap;
+    nn_size_t generation = handle / computer->componentCap;
+    if(idx >= computer->componentLen) return NULL;
+    nn_component *c = computer->components + idx;
+    if(c->address == NULL) return NULL;
+    if(c->generation != generation) return NULL;
+    return c;
+}
+
 nn_component *nn_iterComponent(nn_computer *computer, nn_size_t *internalIndex) {
     for(nn_size_t i = *internalIndex; i < computer->componentLen; i++) {
         if(computer->components[i].address == NULL) continue;
@@ -445,6 +786,11 @@ void nn_resetCall(nn_computer *computer) {
 
     computer->argc = 0;
     computer->retc = 0;
+    nn_arena_reset(computer->callArena);
+}
+
+nn_Alloc *nn_getCallAllocator(nn_computer *computer) {
+    return &computer->callAlloc;
 }
 
 void nn_addArgument(nn_computer *computer, nn_value arg) {
@@ -478,10 +824,12 @@ nn_size_t nn_getReturnCount(nn_computer *computer) {
 }
 
 char *nn_serializeProgram(nn_computer *computer, nn_Alloc *alloc, nn_size_t *len) {
+    if(computer->archState == NULL) return NULL;
     return computer->arch->serialize(computer, alloc, computer->archState, computer->arch->userdata, len);
 }
 
 void nn_deserializeProgram(nn_computer *computer, const char *memory, nn_size_t len) {
+    if(computer->archState == NULL) return;
     computer->arch->deserialize(computer, memory, len, computer->archState, computer->arch->userdata);
 }
 
@@ -514,7 +862,7 @@ void nn_return_cstring(nn_computer *computer, const char *cstr) {
 }
 
 void nn_return_string(nn_computer *computer, const char *str, nn_size_t len) {
-    nn_value val = nn_values_string(&computer->universe->ctx.allocator, str, len);
+    nn_value val = nn_values_string(&computer->callAlloc, str, len);
     if(val.tag == NN_VALUE_NIL) {
         nn_setCError(computer, "out of memory");
     }
@@ -522,7 +870,7 @@ void nn_return_string(nn_computer *computer, const char *str, nn_size_t len) {
 }
 
 nn_value nn_return_array(nn_computer *computer, nn_size_t len) {
-    nn_value val = nn_values_array(&computer->universe->ctx.allocator, len);
+    nn_value val = nn_values_array(&computer->callAlloc, len);
     if(val.tag == NN_VALUE_NIL) {
         nn_setCError(computer, "out of memory");
     }
@@ -531,7 +879,7 @@ nn_value nn_return_array(nn_computer *computer, nn_size_t len) {
 }
 
 nn_value nn_return_table(nn_computer *computer, nn_size_t len) {
-    nn_value val = nn_values_table(&computer->universe->ctx.allocator, len);
+    nn_value val = nn_values_table(&computer->callAlloc, len);
     if(val.tag == NN_VALUE_NIL) {
         nn_setCError(computer, "out of memory");
     }
@@ -547,6 +895,8 @@ nn_bool_t nn_wakeupMatches(nn_value *values, nn_size_t valueLen, const char *wak
     if(valueLen == 0) return false;
     nn_value header = values[0];
     const char *headerStr = nn_toCString(header);
+    // only strings can wake anything up
+    if(headerStr == NULL) return false;
 
     if(fuzzy) {
         return nn_strbegin(headerStr, wakeUp);
@@ -555,20 +905,116 @@ nn_bool_t nn_wakeupMatches(nn_value *values, nn_size_t valueLen, const char *wak
     }
 }
 
-const char *nn_pushNetworkMessage(nn_computer *computer, nn_address receiver, nn_address sender, nn_size_t port, double distance, nn_value *values, nn_size_t valueLen) {
-    nn_Alloc *alloc = &computer->universe->ctx.allocator;
-
-    nn_value buffer[valueLen + 5];
-    buffer[0] = nn_values_cstring("modem_message");
-    buffer[1] = nn_values_string(alloc, receiver, nn_strlen(receiver));
-    buffer[2] = nn_values_string(alloc, sender, nn_strlen(sender));
-    buffer[3] = nn_values_integer(port);
-    buffer[4] = nn_values_number(distance);
+nn_packet *nn_newPacket(nn_Alloc *alloc, nn_address sender, nn_size_t port, nn_value *values, nn_size_t valueLen) {
+    nn_size_t size = nn_measurePacketSize(values, valueLen);
+    // tables and arrays can't be sent
+    if(size == (nn_size_t)-1) return NULL;
+    return nn_newMeasuredPacket(alloc, sender, port, values, valueLen, size);
+}
+
+nn_packet *nn_newMeasuredPacket(nn_Alloc *alloc, nn_address sender, nn_size_t port, nn_value *values, nn_size_t valueLen, nn_size_t size) {
+    nn_packet *packet = nn_alloc(alloc, sizeof(nn_packet) + sizeof(nn_value) * valueLen);
+    if(packet == NULL) return NULL;
+    packet->refc = 1;
+    packet->alloc = *alloc;
+    packet->port = port;
+    packet->size = size;
+    packet->len = valueLen;
+    packet->sender = nn_values_string(alloc, sender, nn_strlen(sender));
+    nn_bool_t failed = packet->sender.tag == NN_VALUE_NIL;
     for(nn_size_t i = 0; i < valueLen; i++) {
-        buffer[i + 5] = nn_values_retain(values[i]);
+        nn_value val = values[i];
+        // the strings are copied, as the sender's copies are the sender's business
+        if(val.tag == NN_VALUE_STR || val.tag == NN_VALUE_CSTR) {
+            nn_size_t len;
+            const char *s = nn_toString(val, &len);
+            val = nn_values_string(alloc, s, len);
+            if(val.tag == NN_VALUE_NIL) failed = true;
+        }
+        packet->values[i] = val;
+    }
+    if(failed) {
+        nn_dropPacket(packet);
+        return NULL;
+    }
+    return packet;
+}
+
+void nn_retainPacket(nn_packet *packet) {
+    nn_incRef(&packet->refc);
+}
+
+void nn_dropPacket(nn_packet *packet) {
+    if(!nn_decRef(&packet->refc)) return;
+    nn_values_drop(packet->sender);
+    nn_values_dropAll(packet->values, packet->len);
+    nn_Alloc alloc = packet->alloc;
+    nn_dealloc(&alloc, packet, sizeof(nn_packet) + sizeof(nn_value) * packet->len);
+}
+
+nn_size_t nn_getPacketSize(nn_packet *packet) {
+    return packet->size;
+}
+
+static const char *nni_checkPacket(nn_address receiver, nn_packet *packet) {
+    if(packet->len + NNI_PACKET_HEADER > NN_MAX_SIGNAL_VALS) return "too many values";
+    // the header, measured the same way nn_measurePacketSize() would
+    nn_size_t headerSize = (2 + 13) + (2 + nn_strlen(receiver)) + (2 + packet->sender.string->len) + (2 + 8) + (2 + 8);
+    if(headerSize + packet->size > NN_MAX_SIGNAL_SIZE) return "too big";
+    return NULL;
+}
+
+// fills in the NNI_PACKET_HEADER values a packet signal holds itself, and takes a reference to the packet
+static const char *nni_fillPacketSignal(nn_Alloc *alloc, nn_value *dst, nn_address receiver, nn_packet *packet, double distance) {
+    nn_value receiverValue = nn_values_string(alloc, receiver, nn_strlen(receiver));
+    if(receiverValue.tag == NN_VALUE_NIL) return "out of memory";
+    nn_retainPacket(packet);
+    dst[0] = nn_values_cstring("modem_message");
+    dst[1] = receiverValue;
+    // read from the packet
+    dst[2] = nn_values_nil();
+    dst[3] = nn_values_integer(packet->port);
+    dst[4] = nn_values_number(distance);
+    return NULL;
+}
+
+const char *nn_pushPacket(nn_computer *computer, nn_address receiver, nn_packet *packet, double distance) {
+    const char *err = nni_checkPacket(receiver, packet);
+    if(err != NULL) return err;
+    nn_signal *p = nni_reserveSignal(computer, &err);
+    if(p == NULL) return err;
+    err = nni_fillPacketSignal(&computer->universe->ctx.allocator, p->values, receiver, packet, distance);
+    if(err != NULL) return err;
+    p->len = packet->len + NNI_PACKET_HEADER;
+    p->packet = packet;
+    computer->signalCount++;
+    return NULL;
+}
+
+const char *nn_postPacket(nn_computer *computer, nn_address receiver, nn_packet *packet, double distance) {
+    const char *err = nni_checkPacket(receiver, packet);
+    if(err != NULL) return err;
+    if(nni_inboxFull(computer)) return "too many signals";
+    nni_inboxNode *node = nni_newInboxNode(computer, packet->len + NNI_PACKET_HEADER, packet);
+    if(node == NULL) return "out of memory";
+    err = nni_fillPacketSignal(&computer->universe->ctx.allocator, node->values, receiver, packet, distance);
+    if(err != NULL) {
+        nni_freeInboxNode(computer, node);
+        return err;
     }
+    nni_postNode(computer, node);
+    return NULL;
+}
 
-    return nn_pushSignal(computer, buffer, valueLen + 5);
+const char *nn_pushNetworkMessage(nn_computer *computer, nn_address receiver, nn_address sender, nn_size_t port, double distance, nn_value *values, nn_size_t valueLen) {
+    nn_size_t size = nn_measurePacketSize(values, valueLen);
+    // tables and arrays
+    if(size == (nn_size_t)-1) return "unsupported data type";
+    nn_packet *packet = nn_newMeasuredPacket(&computer->universe->ctx.allocator, sender, port, values, valueLen, size);
+    if(packet == NULL) return "out of memory";
+    const char *err = nn_pushPacket(computer, receiver, packet, distance);
+    nn_dropPacket(packet);
+    return err;
 }
 
 static nn_resource_t *nn_resource_find(nn_computer *computer, nn_size_t id) {
@@ -3,11 +3,40 @@
 
 #include "neonucleus.h"
 
+#define NNI_CALL_ARENA_CHUNK 4096
+
+// modem_message, receiver, sender, port, distance
+#define NNI_PACKET_HEADER 5
+
+typedef struct nn_packet {
+    nn_refc refc;
+    nn_Alloc alloc;
+    nn_value sender;
+    nn_size_t port;
+    // measured once, when it was made
+    nn_size_t size;
+    nn_size_t len;
+    // owned by the packet alone, so computers on other threads never touch their refcounts
+    nn_value values[];
+} nn_packet;
+
 typedef struct nn_signal {
     nn_size_t len;
+    // If not NULL, this is a modem_message. values only holds the header,
+    // with the sender and the payload read straight out of the shared packet.
+    nn_packet *packet;
     nn_value values[NN_MAX_SIGNAL_VALS];
 } nn_signal;
 
+// a signal posted from another thread, waiting for the next tick
+typedef struct nni_inboxNode {
+    struct nni_inboxNode *next;
+    nn_size_t len;
+    nn_packet *packet;
+    // sized to what the signal stores, so a broadcast doesn't pay for a whole nn_signal per receiver
+    nn_value values[];
+} nni_inboxNode;
+
 typedef struct nn_resource_t {
 	nn_size_t id;
 	void *ptr;
@@ -24,10 +53,17 @@ typedef struct nn_computer {
     nn_component *components;
     nn_size_t componentLen;
     nn_size_t componentCap;
+    // linear probing hash index of components by address.
+    // Stores component index + 1, 0 means empty. Size is a power of 2.
+    nn_size_t *componentIndex;
+    nn_size_t componentIndexCap;
     nn_value args[NN_MAX_ARGS];
     nn_size_t argc;
     nn_value rets[NN_MAX_RETS];
     nn_size_t retc;
+    // backs the call values, reset by nn_resetCall()
+    nn_arena *callArena;
+    nn_Alloc callAlloc;
     nn_architecture *arch; // btw
     void *archState;
     nn_architecture *nextArch;
@@ -39,8 +75,25 @@ typedef struct nn_computer {
     nn_size_t userCount;
     double energy;
     double maxEnergy;
-    nn_signal signals[NN_MAX_SIGNALS];
+    // ring buffer, grows on demand up to NN_MAX_SIGNALS
+    nn_signal *signals;
+    nn_size_t signalCap;
+    nn_size_t signalHead;
     nn_size_t signalCount;
+    // set by nn_sleepComputer(), ticks do nothing until a signal shows up or the universe time reaches sleepUntil
+    nn_bool_t sleeping;
+    double sleepUntil;
+    // Lock-free stack of posted signals, newest first. Anyone can push, the tick takes the whole thing.
+#ifdef NN_BAREMETAL
+    nni_inboxNode *inbox;
+    nn_size_t inboxLen;
+    nn_bool_t wakeRequested;
+#else
+    _Atomic(nni_inboxNode *) inbox;
+    _Atomic(nn_size_t) inboxLen;
+    // set from any thread, the next tick boots a dormant computer
+    _Atomic(nn_bool_t) wakeRequested;
+#endif
     nn_size_t memoryTotal;
     nn_address address;
     nn_address tmpAddress;
@@ -55,6 +108,12 @@ typedef struct nn_computer {
 	double beepFrequency;
 	double beepDuration;
 	double beepVolume;
+	// index into the universe computer list
+	nn_bool_t scheduled;
+	nn_size_t scheduleIdx;
+	// asked for during nn_universe_tickAll(), done once it ends
+	nn_bool_t removeLater;
+	nn_bool_t deleteLater;
 } nn_computer;
 
 #endif
@@ -552,65 +552,39 @@ int keycode_to_oc(int keycode) {
 }
 
 typedef struct ne_premappedPixel {
-    int codepoint;
-    int mappedDepth;
-    int mappedFgFor;
-    int mappedFgRes;
-    int mappedBgFor;
-    int mappedBgRes;
-	nn_bool_t legacyColors;
+    unsigned int codepoint;
+    int fg;
+    int bg;
 } ne_premappedPixel;
 
 bool ne_legacyColors = false;
 
-ne_premappedPixel ne_getPremap(ne_premappedPixel *pixels, nn_screen *screen, int x, int y) {
+void ne_updatePremap(ne_premappedPixel *pixels, nn_screen *screen, int x, int y, int width) {
     int maxW, maxH;
     nn_maxResolution(screen, &maxW, &maxH);
-    int depth = nn_getDepth(screen);
 
-    int i = y * maxW + x;
-    ne_premappedPixel premapped = pixels[i];
-
-    nn_scrchr_t pixel = nn_getPixel(screen, x, y);
-    int fg = pixel.fg;
-    int bg = pixel.bg;
-	
-	if(premapped.legacyColors != ne_legacyColors) {
-		premapped.legacyColors = ne_legacyColors;
-		premapped.mappedDepth = -1;
-	}
-
-    if(premapped.mappedDepth != depth) {
-        premapped.mappedDepth = depth;
-        premapped.mappedFgFor = -1;
-        premapped.mappedBgFor = -1;
+    unsigned int codepoints[width];
+    int fg[width];
+    int bg[width];
+    int len = nn_screen_mapRow(screen, x, y, width, ne_legacyColors, codepoints, fg, bg);
+
+    ne_premappedPixel *row = pixels + y * maxW + x;
+    for(int i = 0; i < len; i++) {
+        row[i] = (ne_premappedPixel) {
+            .codepoint = codepoints[i],
+            .fg = fg[i],
+            .bg = bg[i],
+        };
     }
-
-    bool miss = false;
-
-    if(premapped.mappedFgFor != fg) {
-        premapped.mappedFgFor = fg;
-        premapped.mappedFgRes = nn_mapDepth(fg, depth, ne_legacyColors);
-        miss = true;
-    }
-    if(premapped.mappedBgFor != bg) {
-        premapped.mappedBgFor = bg;
-        premapped.mappedBgRes = nn_mapDepth(bg, depth, ne_legacyColors);
-        miss = true;
-    }
-    premapped.codepoint = pixel.codepoint;
-
-    pixels[i] = premapped;
-    return premapped;
 }
 
 ne_premappedPixel *ne_allocPremap(int width, int height) {
     int len = width * height;
     ne_premappedPixel *pixels = malloc(sizeof(ne_premappedPixel) * len);
     for(int i = 0; i < len; i++) pixels[i] = (ne_premappedPixel) {
-        .mappedDepth = -1,
-        .mappedFgFor = -1,
-        .mappedBgFor = -1,
+        .codepoint = ' ',
+        .fg = 0xFFFFFF,
+        .bg = 0x000000,
     };
     return pixels;
 }
@@ -698,7 +672,17 @@ int main(int argc, char **argv) {
         .read = (void *)ne_fs_read,
         .seek = (void *)ne_fs_seek,
     };
-    nn_filesystem *genericFS = nn_newFilesystem(&ctx, genericFSTable, ne_fs_ctrl);
+    nn_filesystem *genericFS = NULL;
+#ifdef NN_POSIX
+    nn_hostFilesystemOptions genericFSOpts = {
+        .root = ne_location(fsFolder),
+        .capacity = 1*1024*1024,
+        .isReadOnly = false,
+    };
+    genericFS = nn_hostFilesystem(&ctx, genericFSOpts, ne_fs_ctrl);
+#endif
+    // falls back to the slow table where the engine has no host filesystem
+    if(genericFS == NULL) genericFS = nn_newFilesystem(&ctx, genericFSTable, ne_fs_ctrl);
     nn_addFileSystem(computer, NULL, 1, genericFS);
 
 	nn_vfilesystemImageNode tmpfsImg[] = {
@@ -973,8 +957,19 @@ render:
 		}
 		if(IsKeyPressed(KEY_F4)) {
 			ne_legacyColors = !ne_legacyColors;
+			nn_setDirty(s, true);
 		}
 
+		// only remap what changed
+		size_t damageIter = 0;
+		nn_screenRect damage;
+		while(nn_iterDamage(s, &damageIter, &damage)) {
+			for(int y = damage.y; y < damage.y + damage.height; y++) {
+				ne_updatePremap(premap, s, damage.x, y, damage.width);
+			}
+		}
+		nn_clearDamage(s);
+
         BeginDrawing();
 
         ClearBackground(BLACK);
@@ -991,13 +986,16 @@ render:
 			int offX = (GetScreenWidth() - scrW * pixelWidth) / 2;
 			int offY = (GetScreenHeight() - scrH * pixelHeight) / 2;
 
+			int maxW, maxH;
+			nn_maxResolution(s, &maxW, &maxH);
+
 			for(size_t x = 0; x < scrW; x++) {
 				for(size_t y = 0; y < scrH; y++) {
-					ne_premappedPixel p = ne_getPremap(premap, s, x, y);
+					ne_premappedPixel p = premap[y * maxW + x];
 
 					// fuck palettes
-					Color fgColor = ne_processColor(p.mappedFgRes);
-					Color bgColor = ne_processColor(p.mappedBgRes);
+					Color fgColor = ne_processColor(p.fg);
+					Color bgColor = ne_processColor(p.bg);
 					DrawRectangle(x * pixelWidth + offX, y * pixelHeight + offY, pixelWidth, pixelHeight, bgColor);
 					DrawTextCodepoint(unscii, p.codepoint, (Vector2) {x * pixelWidth + offX, y * pixelHeight + offY}, pixelHeight - 5, fgColor);
 				}
@@ -222,6 +222,10 @@ const char *nn_strchr(const char *str, int ch);
 int nn_strcmp(const char *a, const char *b);
 nn_size_t nn_strlen(const char *a);
 nn_bool_t nn_strbegin(const char *s, const char *prefix);
+// FNV-1a, not cryptographic in the slightest
+unsigned int nn_strhash(const char *s);
+// same hash as nn_strhash(), but over len bytes
+unsigned int nn_memhash(const char *s, nn_size_t len);
 
 #ifndef NN_BAREMETAL
 nn_Alloc nn_libcAllocator(void);
@@ -252,11 +256,13 @@ void nn_error_clear(nn_errorbuf_t buf);
 #define NN_VALUE_NIL 7
 #define NN_VALUE_RESOURCE 8
 
+// The header and the bytes are a single allocation.
 typedef struct nn_string {
-    char *data;
     nn_size_t len;
     nn_size_t refc;
+    // NULL proc means it is a shared static string, which is never freed
     nn_Alloc alloc;
+    char data[];
 } nn_string;
 
 typedef struct nn_array {
@@ -297,6 +303,17 @@ void *nn_alloc(nn_Alloc *alloc, nn_size_t size);
 void *nn_resize(nn_Alloc *alloc, void *memory, nn_size_t oldSize, nn_size_t newSize);
 void nn_dealloc(nn_Alloc *alloc, void *memory, nn_size_t size);
 
+// Bump allocator for short-lived stuff, like the values of a single component call.
+// Deallocating through it does nothing, except for the most recent allocation.
+typedef struct nn_arena nn_arena;
+nn_arena *nn_newArena(nn_Alloc *backing, nn_size_t chunkSize);
+void nn_destroyArena(nn_arena *arena);
+// frees everything allocated since the last reset, all at once
+void nn_arena_reset(nn_arena *arena);
+nn_Alloc nn_arena_allocator(nn_arena *arena);
+nn_Alloc *nn_arena_getBacking(nn_arena *arena);
+nn_bool_t nn_isArenaAllocator(nn_Alloc *alloc);
+
 // Utilities, both internal and external
 char *nn_strdup(nn_Alloc *alloc, const char *s);
 void *nn_memdup(nn_Alloc *alloc, const void *buf, nn_size_t len);
@@ -413,6 +430,44 @@ void *nn_queryUserdata(nn_universe *universe, const char *name);
 void nn_storeUserdata(nn_universe *universe, const char *name, void *data);
 double nn_getTime(nn_universe *universe);
 
+// Scheduling
+// Registered computers are ticked by nn_universe_tickAll(), spread over a worker pool.
+// Each computer is ticked with its lock (nn_getComputerLock()) held.
+// Removing or deleting computers from inside a tick or the tick callback is deferred until the tick ends.
+// Adding one from there fails, do it between ticks.
+
+typedef struct nn_tickStats {
+    // wall time of the entire tick, in seconds
+    double wallTime;
+    // wall time of the slowest computer, in seconds
+    double slowestComputer;
+    nn_size_t computersTicked;
+    // how many times a worker ran out of work and took some from another
+    nn_size_t steals;
+    // skipped because they were waiting on a signal, see nn_sleepComputer()
+    nn_size_t computersSleeping;
+} nn_tickStats;
+
+// Called on the worker thread right after a computer was ticked, with the computer lock still held.
+// state is what nn_tickComputer() returned.
+// nn_deleteComputer() from here only marks the computer, it is deleted after every worker is done.
+typedef void nn_universe_tickCallback(void *userdata, nn_computer *computer, int state);
+
+nn_bool_t nn_universe_addComputer(nn_universe *universe, nn_computer *computer);
+// does nothing if the computer was never added. nn_deleteComputer() calls this for you.
+// During nn_universe_tickAll() the removal only happens once the tick ends.
+void nn_universe_removeComputer(nn_universe *universe, nn_computer *computer);
+nn_size_t nn_universe_getComputerCount(nn_universe *universe);
+nn_computer *nn_universe_getComputer(nn_universe *universe, nn_size_t idx);
+// workerCount includes the thread calling nn_universe_tickAll(), so 1 means no extra threads.
+// On baremetal, or if threads can't be made, this returns false and ticking stays single-threaded.
+nn_bool_t nn_universe_setWorkerCount(nn_universe *universe, nn_size_t workerCount);
+nn_size_t nn_universe_getWorkerCount(nn_universe *universe);
+// stats and callback can be NULL
+void nn_universe_tickAll(nn_universe *universe, nn_universe_tickCallback *callback, void *userdata, nn_tickStats *stats);
+// wall time of the last nn_universe_tickAll(), in seconds
+double nn_universe_getLastTickTime(nn_universe *universe);
+
 // Device info
 
 typedef struct nn_deviceInfoList_t nn_deviceInfoList_t;
@@ -469,6 +524,9 @@ nn_architecture *nn_getNextArchitecture(nn_computer *computer);
 void nn_setNextArchitecture(nn_computer *computer, nn_architecture *arch);
 void nn_deleteComputer(nn_computer *computer);
 const char *nn_pushSignal(nn_computer *computer, nn_value *values, nn_size_t len);
+// Like nn_pushSignal(), but safe to call from any thread without the computer lock, and it never blocks.
+// The signal shows up at the start of the next nn_tickComputer().
+const char *nn_postSignal(nn_computer *computer, nn_value *values, nn_size_t len);
 nn_value nn_fetchSignalValue(nn_computer *computer, nn_size_t index);
 nn_size_t nn_signalSize(nn_computer *computer);
 void nn_popSignal(nn_computer *computer);
@@ -523,7 +581,24 @@ nn_guard *nn_getComputerLock(nn_computer *computer);
 /// The machine is overworked.
 #define NN_STATE_OVERWORKED 7
 
+/// The computer is off, but keeps its components, address and energy.
+/// The architecture state is gone, so it takes no memory and ticking it does next to nothing.
+/// It boots again on nn_wakeComputer(), or on the tick after nn_requestComputerWake().
+#define NN_STATE_DORMANT 8
+
 int nn_getState(nn_computer *computer);
+// Tears down the architecture and drops all signals, see NN_STATE_DORMANT. Call it with the computer lock held.
+void nn_makeComputerDormant(nn_computer *computer);
+nn_bool_t nn_isComputerDormant(nn_computer *computer);
+// Sets the architecture up again, with the lock held. False if that failed, and it stays dormant.
+nn_bool_t nn_wakeComputer(nn_computer *computer);
+// Safe from any thread without the lock. A dormant computer boots on its next tick, anything else ignores it.
+void nn_requestComputerWake(nn_computer *computer);
+// For architectures waiting on a signal, like pullSignal(). Until a signal arrives or timeout seconds pass,
+// nn_tickComputer() returns right away without ticking the architecture, and nn_universe_tickAll() skips it.
+// The architecture must call it again every time it wants to wait.
+void nn_sleepComputer(nn_computer *computer, double timeout);
+nn_bool_t nn_isComputerSleeping(nn_computer *computer);
 void nn_setState(nn_computer *computer, int state);
 
 void nn_computer_clearBeep(nn_computer *computer);
@@ -574,6 +649,12 @@ nn_componentTable *nn_getComponentTable(nn_component *component);
 const char *nn_getComponentType(nn_componentTable *table);
 void *nn_getComponentUserdata(nn_component *component);
 nn_component *nn_findComponent(nn_computer *computer, nn_address address);
+// Handles are cheap to resolve and can be cached by the architecture in place of the address.
+// Once the component is destroyed, its handle resolves to NULL, even if the slot gets reused.
+// NN_NULL_COMPONENT never resolves to anything.
+#define NN_NULL_COMPONENT 0
+nn_size_t nn_getComponentHandle(nn_component *component);
+nn_component *nn_resolveComponentHandle(nn_computer *computer, nn_size_t handle);
 // the internal index is not the array index, but rather an index into
 // an internal structure. YOU SHOULD NOT ADD OR REMOVE COMPONENTS WHILE ITERATING.
 // the internalIndex SHOULD BE INITIALIZED TO 0.
@@ -595,6 +676,10 @@ void nn_method_setDirect(nn_method_t *method, nn_bool_t direct);
 void nn_method_setUserdata(nn_method_t *method, void *userdata);
 void nn_method_setCondition(nn_method_t *method, nn_componentMethodCondition_t *condition);
 const char *nn_getTableMethod(nn_componentTable *table, nn_size_t idx, nn_bool_t *outDirect);
+#define NN_METHOD_NONE ((nn_size_t)-1)
+// Returns the method ID, which is the same idx nn_getTableMethod() takes, or NN_METHOD_NONE.
+// IDs never change once a method is defined, so they can be resolved once and cached.
+nn_size_t nn_findMethod(nn_componentTable *table, const char *methodName);
 const char *nn_methodDoc(nn_componentTable *table, const char *methodName);
 nn_bool_t nn_isMethodEnabled(nn_component *component, const char *methodName);
 
@@ -623,8 +708,13 @@ void nn_resource_release(nn_computer *computer, nn_size_t id);
 
 /* Returns false if the method does not exist */
 nn_bool_t nn_invokeComponentMethod(nn_component *component, const char *name);
+/* Same as above, but skips the name lookup. methodId comes from nn_findMethod() on the component's table */
+nn_bool_t nn_invokeComponentMethodById(nn_component *component, nn_size_t methodId);
 void nn_simulateBufferedIndirect(nn_component *component, double amount, double amountPerTick);
+// also resets the call arena, so any value from it that wasn't retained is gone
 void nn_resetCall(nn_computer *computer);
+// The allocator to use for arguments passed to nn_addArgument(). It is a per-computer arena reset by nn_resetCall().
+nn_Alloc *nn_getCallAllocator(nn_computer *computer);
 void nn_addArgument(nn_computer *computer, nn_value arg);
 void nn_return(nn_computer *computer, nn_value val);
 nn_value nn_getArgument(nn_computer *computer, nn_size_t idx);
@@ -640,6 +730,11 @@ nn_value nn_values_number(double num);
 nn_value nn_values_boolean(nn_bool_t boolean);
 nn_value nn_values_cstring(const char *string);
 nn_value nn_values_string(nn_Alloc *alloc, const char *string, nn_size_t len);
+// An uninitialized string of len bytes, meant to be written into through ->string->data.
+nn_value nn_values_stringBuffer(nn_Alloc *alloc, nn_size_t len);
+// Cuts a string made by nn_values_stringBuffer() down to len bytes. It must not be shared yet.
+// If we run out of memory, the string is dropped, val becomes nil and this returns false.
+nn_bool_t nn_values_shrinkString(nn_value *val, nn_size_t len);
 nn_value nn_values_array(nn_Alloc *alloc, nn_size_t len);
 nn_value nn_values_table(nn_Alloc *alloc, nn_size_t pairCount);
 nn_value nn_values_resource(nn_size_t id);
@@ -655,7 +750,12 @@ nn_value nn_return_table(nn_computer *computer, nn_size_t len);
 void nn_return_resource(nn_computer *computer, nn_size_t userdata);
 
 nn_size_t nn_values_getType(nn_value val);
+// Values allocated from an arena (like the ones made by nn_return_string()) are copied onto the heap,
+// so the returned value must be used instead of val.
 nn_value nn_values_retain(nn_value val);
+// Takes ownership of val and returns a copy of it which does not live in an arena.
+// Values which are already on the heap are returned as is.
+nn_value nn_values_escape(nn_value val);
 void nn_values_drop(nn_value val);
 void nn_values_dropAll(nn_value *values, nn_size_t len);
 
@@ -781,6 +881,11 @@ typedef struct nn_filesystemTable {
     nn_size_t (*setLabel)(void *userdata, const char *buf, nn_size_t buflen, nn_errorbuf_t err);
 
     nn_size_t (*spaceUsed)(void *userdata);
+    // Set this if spaceUsed() is a running counter and thus O(1).
+    // Otherwise its result is cached, and recomputed after anything which may change it.
+    nn_bool_t spaceUsedIsCounted;
+    // Optional, how many files and directories there are. Should also be a running counter.
+    nn_size_t (*nodesUsed)(void *userdata);
     nn_size_t spaceTotal;
     nn_bool_t (*isReadOnly)(void *userdata, nn_errorbuf_t err);
 
@@ -807,6 +912,9 @@ typedef struct nn_filesystemTable {
     nn_bool_t (*close)(void *userdata, void *fd, nn_errorbuf_t err);
     nn_bool_t (*write)(void *userdata, void *fd, const char *buf, nn_size_t len, nn_errorbuf_t err);
     nn_size_t (*read)(void *userdata, void *fd, char *buf, nn_size_t required, nn_errorbuf_t err);
+    // Optional. Like read, but returns the bytes as a string allocated with alloc, sized to what was actually read.
+    // Return nil at EoF. If NULL, read is done straight into a preallocated string which is then shrunk.
+    nn_value (*readValue)(nn_Alloc *alloc, void *userdata, void *fd, nn_size_t required, nn_errorbuf_t err);
     nn_size_t (*seek)(void *userdata, void *fd, const char *whence, int off, nn_errorbuf_t err);
 } nn_filesystemTable;
 
@@ -835,7 +943,36 @@ typedef struct nn_vfilesystemOptions {
 
 nn_filesystem *nn_newFilesystem(nn_Context *context, nn_filesystemTable table, nn_filesystemControl control);
 nn_filesystem *nn_volatileFilesystem(nn_Context *context, nn_vfilesystemOptions opts, nn_filesystemControl control);
+
+// An immutable copy of a filesystem image, meant to be shared by many overlay filesystems.
+typedef struct nn_fsImage nn_fsImage;
+nn_fsImage *nn_newFsImage(nn_Context *context, nn_vfilesystemImageNode *nodes, nn_size_t rootEntries);
+void nn_retainFsImage(nn_fsImage *image);
+// drops a reference, returns whether it was actually freed
+nn_bool_t nn_destroyFsImage(nn_fsImage *image);
+// Like nn_volatileFilesystem(), but the files are read straight out of the image
+// and only copied when they're first written to. opts.image is ignored.
+// The filesystem holds a reference to the image.
+nn_filesystem *nn_overlayFilesystem(nn_Context *context, nn_vfilesystemOptions opts, nn_fsImage *image, nn_filesystemControl control);
+#if !defined(NN_BAREMETAL) && defined(NN_POSIX)
+typedef struct nn_hostFilesystemOptions {
+    // directory on the host, must already exist
+    const char *root;
+    nn_size_t capacity;
+    nn_bool_t isReadOnly;
+    char label[NN_LABEL_SIZE];
+    nn_size_t labelLen;
+} nn_hostFilesystemOptions;
+
+// A filesystem stored in a directory on the host. Reads are mmap()'d and stats are cached,
+// so changes made by the host while it is in use may take a moment to be seen.
+// Returns NULL if root can't be opened. Only there on POSIX hosts.
+nn_filesystem *nn_hostFilesystem(nn_Context *context, nn_hostFilesystemOptions opts, nn_filesystemControl control);
+#endif
 nn_guard *nn_getFilesystemLock(nn_filesystem *fs);
+nn_size_t nn_getFilesystemSpaceUsed(nn_filesystem *fs);
+// 0 if the filesystem doesn't keep track of it
+nn_size_t nn_getFilesystemNodesUsed(nn_filesystem *fs);
 void nn_retainFilesystem(nn_filesystem *fs);
 nn_bool_t nn_destroyFilesystem(nn_filesystem *fs);
 
@@ -873,10 +1010,19 @@ typedef struct nn_driveTable {
 
     // sectors start at 1 as per OC.
     void (*readSector)(void *userdata, int sector, char *buf);
-    void (*writeSector)(void *userdata, int sector, const char *buf);
-
-    // readByte and writeByte will internally use readSector and writeSector. This is to ensure they are handled *consistently.*
-    // Also makes the interface less redundant
+    // Writes can fail (out of memory, the host disk), in which case err is set and the call errors.
+    void (*writeSector)(void *userdata, int sector, const char *buf, nn_errorbuf_t err);
+
+    // The rest are optional and only there to make bulk transfers cheap.
+    // If NULL, they are done with readSector and writeSector, which is also what readByte and writeByte fall back to.
+    // count sectors starting at sector, the range is always in bounds.
+    void (*readSectors)(void *userdata, int sector, nn_size_t count, char *buf);
+    void (*writeSectors)(void *userdata, int sector, nn_size_t count, const char *buf, nn_errorbuf_t err);
+    // offset starts at 0 here, the range is always in bounds.
+    void (*readBytes)(void *userdata, nn_size_t offset, nn_size_t len, char *buf);
+    void (*writeBytes)(void *userdata, nn_size_t offset, nn_size_t len, const char *buf, nn_errorbuf_t err);
+    // Optional, makes whatever was written so far persistent.
+    void (*flush)(void *userdata);
 } nn_driveTable;
 
 typedef struct nn_vdriveOptions {
@@ -892,9 +1038,29 @@ typedef struct nn_drive nn_drive;
 
 nn_drive *nn_newDrive(nn_Context *context, nn_driveTable table, nn_driveControl control);
 nn_drive *nn_volatileDrive(nn_Context *context, nn_vdriveOptions opts, nn_driveControl control);
+
+#if !defined(NN_BAREMETAL) && defined(NN_POSIX)
+typedef struct nn_fileDriveOptions {
+    // image on the host, created or grown to capacity if needed
+    const char *path;
+    nn_size_t sectorSize;
+    nn_size_t platterCount;
+    nn_size_t capacity;
+    char label[NN_LABEL_SIZE];
+    nn_size_t labelLen;
+} nn_fileDriveOptions;
+
+// A drive backed by an image file on the host, which is mmap()'d and written back by the OS.
+// The image's blocks are allocated upfront so a full disk can't crash us later, if that fails it uses pread()/pwrite() instead.
+// Call nn_flushDrive() to make sure it actually hit the disk.
+// Returns NULL if the image can't be opened. Only there on POSIX hosts.
+nn_drive *nn_fileDrive(nn_Context *context, nn_fileDriveOptions opts, nn_driveControl control);
+#endif
 nn_guard *nn_getDriveLock(nn_drive *drive);
 void nn_retainDrive(nn_drive *drive);
 nn_bool_t nn_destroyDrive(nn_drive *drive);
+// does nothing if the drive has no flush
+void nn_flushDrive(nn_drive *drive);
 
 nn_component *nn_addDrive(nn_computer *computer, nn_address address, int slot, nn_drive *drive);
 
@@ -960,9 +1126,36 @@ void nn_getLegacy4BitPalette(int color[16]);
 
 void nn_setPixel(nn_screen *screen, int x, int y, nn_scrchr_t pixel);
 nn_scrchr_t nn_getPixel(nn_screen *screen, int x, int y);
+// Maps width cells of row y, starting at column x (0-indexed), to what they should look like.
+// Palette indexes are resolved, and colors are mapped to the current depth like nn_mapDepth() would.
+// Results are cached per screen, and the cache is rebuilt when the depth, palette or legacy flag changes,
+// so this is much cheaper than calling nn_mapDepth() per cell.
+// Any of the output arrays can be NULL. The row is cut off at the max width.
+// Returns how many cells were written. Like everything else here, hold the screen lock.
+int nn_screen_mapRow(nn_screen *screen, int x, int y, int width, nn_bool_t legacy, unsigned int *codepoints, int *fg, int *bg);
 
 nn_bool_t nn_isDirty(nn_screen *screen);
+// setting it to true damages the whole screen, setting it to false clears all damage
 void nn_setDirty(nn_screen *screen, nn_bool_t dirty);
+
+// Damage tracking
+// Every changed cell is recorded, so renderers only need to redraw what changed.
+// Resolution, depth and palette changes damage the whole screen.
+
+typedef struct nn_screenRect {
+    int x;
+    int y;
+    int width;
+    int height;
+} nn_screenRect;
+
+// marks an area as changed. Clipped to the max resolution.
+void nn_damageScreen(nn_screen *screen, int x, int y, int width, int height);
+// the internalIndex SHOULD BE INITIALIZED TO 0.
+// Returns false at the end. Rectangles never overlap, and are 0-indexed.
+nn_bool_t nn_iterDamage(nn_screen *screen, nn_size_t *internalIndex, nn_screenRect *rect);
+// forgets all damage, call it once everything has been redrawn
+void nn_clearDamage(nn_screen *screen);
 nn_bool_t nn_isPrecise(nn_screen *screen);
 void nn_setPrecise(nn_screen *screen, nn_bool_t precise);
 nn_bool_t nn_isTouchModeInverted(nn_screen *screen);
@@ -1008,9 +1201,47 @@ typedef struct nn_networkControl {
 nn_bool_t nn_wakeupMatches(nn_value *values, nn_size_t valueLen, const char *wakeUp, nn_bool_t fuzzy);
 
 // NULL on success, error string on failure
-// this *retains* all of those values, meaning you must drop them after call this function
+// this *copies* all of those values, meaning you must drop them after call this function
 const char *nn_pushNetworkMessage(nn_computer *computer, nn_address receiver, nn_address sender, nn_size_t port, double distance, nn_value *values, nn_size_t valueLen);
 
+// A network message, made once and shared by every computer it is delivered to.
+typedef struct nn_packet nn_packet;
+
+// The values are copied. NULL if they can't be sent (tables and arrays) or we ran out of memory.
+// To tell those apart, check nn_measurePacketSize() yourself and use nn_newMeasuredPacket().
+nn_packet *nn_newPacket(nn_Alloc *alloc, nn_address sender, nn_size_t port, nn_value *values, nn_size_t valueLen);
+// For when you already called nn_measurePacketSize(), so the values aren't walked twice.
+nn_packet *nn_newMeasuredPacket(nn_Alloc *alloc, nn_address sender, nn_size_t port, nn_value *values, nn_size_t valueLen, nn_size_t size);
+void nn_retainPacket(nn_packet *packet);
+void nn_dropPacket(nn_packet *packet);
+// what nn_measurePacketSize() said about the values
+nn_size_t nn_getPacketSize(nn_packet *packet);
+// Like nn_pushNetworkMessage(), but the signal only holds a reference to the packet.
+// NULL on success, error string on failure
+const char *nn_pushPacket(nn_computer *computer, nn_address receiver, nn_packet *packet, double distance);
+// nn_postSignal() for packets
+const char *nn_postPacket(nn_computer *computer, nn_address receiver, nn_packet *packet, double distance);
+
+// The open ports of a modem, one bit per port, for modem implementations.
+#define NN_PORTSET_WORD_BITS (sizeof(nn_size_t) * 8)
+
+typedef struct nn_portSet {
+    nn_size_t count;
+    nn_size_t max;
+    nn_size_t bits[(NN_PORT_MAX + 1) / NN_PORTSET_WORD_BITS];
+} nn_portSet;
+
+void nn_portSet_init(nn_portSet *set, nn_size_t maxOpenPorts);
+nn_bool_t nn_portSet_isOpen(const nn_portSet *set, nn_size_t port);
+nn_bool_t nn_portSet_isFull(const nn_portSet *set);
+// false if it was already open or the set is full
+nn_bool_t nn_portSet_open(nn_portSet *set, nn_size_t port);
+// false if it wasn't open
+nn_bool_t nn_portSet_close(nn_portSet *set, nn_size_t port);
+void nn_portSet_closeAll(nn_portSet *set);
+// ports must have room for set->max ports, they come out in ascending order
+nn_size_t nn_portSet_getPorts(const nn_portSet *set, nn_size_t *ports);
+
 typedef struct nn_modemTable {
     void *userdata;
     void (*deinit)(void *userdata);
@@ -1034,6 +1265,10 @@ typedef struct nn_modemTable {
 
     // Address is NULL if broadcasting
     nn_bool_t (*send)(void *userdata, nn_address address, nn_size_t port, nn_value *values, nn_size_t valueCount, nn_errorbuf_t err);
+    // Optional. If set, it is used instead of send, with a packet which was measured once and can be
+    // shared by every receiver (see nn_pushPacket()). The packet's sender is the modem's component address.
+    // Retain the packet if you keep it.
+    nn_bool_t (*sendPacket)(void *userdata, nn_address address, nn_packet *packet, nn_errorbuf_t err);
 
     // signal strength
     double maxStrength;
@@ -1049,6 +1284,7 @@ typedef struct nn_modem nn_modem;
 
 typedef struct nn_debugLoopbackNetworkOpts {
     nn_computer *computer;
+    // the modem's own address, the same you give nn_addModem(). Messages come from and go to it.
     nn_address address;
     nn_size_t maxValues;
     nn_size_t maxPacketSize;
@@ -1057,9 +1293,32 @@ typedef struct nn_debugLoopbackNetworkOpts {
     nn_bool_t isWireless;
 } nn_debugLoopbackNetworkOpts;
 
+// A modem plugged into the universe's network.
+typedef struct nn_networkModemOpts {
+    // the computer it is in, messages are delivered to it
+    nn_computer *computer;
+    // what others send() to, the same address you give nn_addModem()
+    nn_address address;
+    // Wired modems on the same segment hear each other. 0 means unplugged.
+    nn_size_t segment;
+    // Wireless modems hear other wireless modems within the sender's strength, in blocks.
+    nn_bool_t isWireless;
+    double x, y, z;
+    nn_size_t maxValues;
+    nn_size_t maxPacketSize;
+    nn_size_t maxOpenPorts;
+    double maxStrength;
+} nn_networkModemOpts;
+
 nn_modem *nn_newModem(nn_Context *context, nn_modemTable table, nn_networkControl control);
 nn_modem *nn_debugLoopbackModem(nn_Context *context, nn_debugLoopbackNetworkOpts opts, nn_networkControl control);
+// The universe is the one opts.computer is in.
+nn_modem *nn_networkModem(nn_Context *context, nn_networkModemOpts opts, nn_networkControl control);
+// false if it is not a network modem
+nn_bool_t nn_moveNetworkModem(nn_modem *modem, double x, double y, double z);
+nn_bool_t nn_setNetworkModemSegment(nn_modem *modem, nn_size_t segment);
 nn_guard *nn_getModemLock(nn_modem *modem);
+nn_modemTable *nn_getModemTable(nn_modem *modem);
 void nn_retainModem(nn_modem *modem);
 nn_bool_t nn_destroyModem(nn_modem *modem);
 
@@ -0,0 +1,584 @@
+#include "neonucleus.h"
+#include "universe.h"
+#include "computer.h"
+
+// The universe network fabric.
+// Network modems attach to it as endpoints. Wired endpoints on the same segment hear each other,
+// wireless ones hear anything within the sender's strength.
+// Dormant computers get no payloads, but any packet reaching them which matches their wake message boots them,
+// whatever port it was sent to. The modems with a wake message are kept in their own list for that.
+// Every open port knows its listeners, so a broadcast only looks at the modems which could take it,
+// and a send builds one packet which every receiver shares.
+
+typedef struct nni_netEndpoint nni_netEndpoint;
+
+typedef struct nni_netPort {
+    // NN_PORT_CLOSEALL if the slot is empty
+    nn_size_t port;
+    nni_netEndpoint **listeners;
+    nn_size_t len;
+    nn_size_t cap;
+} nni_netPort;
+
+typedef struct nni_network {
+    nn_Context ctx;
+    nn_guard *lock;
+    nni_netEndpoint **endpoints;
+    nn_size_t endpointLen;
+    nn_size_t endpointCap;
+    // open addressing, NULL means empty. Never more than half full.
+    nni_netEndpoint **byAddress;
+    nn_size_t addressCap;
+    // open addressing too, slots are never removed, only emptied of listeners
+    nni_netPort *ports;
+    nn_size_t portLen;
+    nn_size_t portCap;
+    // the endpoints with a wake message
+    nni_netEndpoint **wakers;
+    nn_size_t wakerLen;
+    nn_size_t wakerCap;
+} nni_network;
+
+struct nni_netEndpoint {
+    nni_network *net;
+    nn_Context ctx;
+    nn_computer *computer;
+    char *address;
+    nn_size_t segment;
+    nn_bool_t wireless;
+    double x, y, z;
+    double strength;
+    double maxStrength;
+    nn_portSet ports;
+    // NUL terminated for nn_wakeupMatches()
+    char wakeup[NN_MAX_WAKEUPMSG + 1];
+    nn_size_t wakeupLen;
+    nn_bool_t wakeupFuzzy;
+    // mirrors the computer's state, so senders don't need its lock
+    nn_bool_t dormant;
+    // where we are in net->endpoints
+    nn_size_t idx;
+    // where we are in net->wakers, if wakeupLen > 0
+    nn_size_t wakerIdx;
+};
+
+static double nni_network_sqrt(double x) {
+    if(x <= 0) return 0;
+    // good enough for distances, and baremetal has no libm
+    double r = x > 1 ? x : 1;
+    for(int i = 0; i < 64; i++) {
+        double next = (r + x / r) / 2;
+        if(next >= r) break;
+        r = next;
+    }
+    return r;
+}
+
+nni_network *nni_network_new(nn_Context *ctx) {
+    nni_network *net = nn_alloc(&ctx->allocator, sizeof(nni_network));
+    if(net == NULL) return NULL;
+    net->ctx = *ctx;
+    net->lock = nn_newGuard(ctx);
+    if(net->lock == NULL) {
+        nn_dealloc(&ctx->allocator, net, sizeof(nni_network));
+        return NULL;
+    }
+    net->endpoints = NULL;
+    net->endpointLen = 0;
+    net->endpointCap = 0;
+    net->byAddress = NULL;
+    net->addressCap = 0;
+    net->ports = NULL;
+    net->portLen = 0;
+    net->portCap = 0;
+    net->wakers = NULL;
+    net->wakerLen = 0;
+    net->wakerCap = 0;
+    return net;
+}
+
+void nni_network_free(nni_network *net) {
+    nn_Alloc *alloc = &net->ctx.allocator;
+    for(nn_size_t i = 0; i < net->portCap; i++) {
+        nni_netPort *p = &net->ports[i];
+        if(p->port == NN_PORT_CLOSEALL) continue;
+        nn_dealloc(alloc, p->listeners, sizeof(nni_netEndpoint *) * p->cap);
+    }
+    nn_dealloc(alloc, net->ports, sizeof(nni_netPort) * net->portCap);
+    nn_dealloc(alloc, net->byAddress, sizeof(nni_netEndpoint *) * net->addressCap);
+    nn_dealloc(alloc, net->wakers, sizeof(nni_netEndpoint *) * net->wakerCap);
+    // endpoints belong to their modems
+    for(nn_size_t i = 0; i < net->endpointLen; i++) {
+        net->endpoints[i]->net = NULL;
+    }
+    nn_dealloc(alloc, net->endpoints, sizeof(nni_netEndpoint *) * net->endpointCap);
+    nn_deleteGuard(&net->ctx, net->lock);
+    nn_dealloc(alloc, net, sizeof(nni_network));
+}
+
+static void nni_network_indexAddress(nni_network *net, nni_netEndpoint *ep) {
+    nn_size_t mask = net->addressCap - 1;
+    nn_size_t i = nn_strhash(ep->address) & mask;
+    while(net->byAddress[i] != NULL) i = (i + 1) & mask;
+    net->byAddress[i] = ep;
+}
+
+// rebuilds the address index with room for at least count endpoints
+static nn_bool_t nni_network_rebuildAddresses(nni_network *net, nn_size_t count) {
+    nn_Alloc *alloc = &net->ctx.allocator;
+    nn_size_t cap = net->addressCap;
+    if(cap < 16) cap = 16;
+    while(cap < count * 2) cap *= 2;
+    if(cap != net->addressCap) {
+        nni_netEndpoint **byAddress = nn_alloc(alloc, sizeof(nni_netEndpoint *) * cap);
+        if(byAddress == NULL) return false;
+        nn_dealloc(alloc, net->byAddress, sizeof(nni_netEndpoint *) * net->addressCap);
+        net->byAddress = byAddress;
+        net->addressCap = cap;
+    }
+    for(nn_size_t i = 0; i < net->addressCap; i++) net->byAddress[i] = NULL;
+    for(nn_size_t i = 0; i < net->endpointLen; i++) {
+        nni_network_indexAddress(net, net->endpoints[i]);
+    }
+    return true;
+}
+
+static nni_netEndpoint *nni_network_findAddress(nni_network *net, nn_address address) {
+    if(net->addressCap == 0) return NULL;
+    nn_size_t mask = net->addressCap - 1;
+    nn_size_t i = nn_strhash(address) & mask;
+    while(net->byAddress[i] != NULL) {
+        if(nn_strcmp(net->byAddress[i]->address, address) == 0) return net->byAddress[i];
+        i = (i + 1) & mask;
+    }
+    return NULL;
+}
+
+static nni_netPort *nni_network_findPort(nni_network *net, nn_size_t port) {
+    if(net->portCap == 0) return NULL;
+    nn_size_t mask = net->portCap - 1;
+    nn_size_t i = (port * 2654435761u) & mask;
+    while(net->ports[i].port != NN_PORT_CLOSEALL) {
+        if(net->ports[i].port == port) return &net->ports[i];
+        i = (i + 1) & mask;
+    }
+    return NULL;
+}
+
+static nni_netPort *nni_network_addPort(nni_network *net, nn_size_t port) {
+    nni_netPort *p = nni_network_findPort(net, port);
+    if(p != NULL) return p;
+    if((net->portLen + 1) * 2 > net->portCap) {
+        nn_Alloc *alloc = &net->ctx.allocator;
+        nn_size_t cap = net->portCap * 2;
+        if(cap < 16) cap = 16;
+        nni_netPort *ports = nn_alloc(alloc, sizeof(nni_netPort) * cap);
+        if(ports == NULL) return NULL;
+        for(nn_size_t i = 0; i < cap; i++) {
+            ports[i].port = NN_PORT_CLOSEALL;
+        }
+        nni_netPort *old = net->ports;
+        nn_size_t oldCap = net->portCap;
+        net->ports = ports;
+        net->portCap = cap;
+        for(nn_size_t i = 0; i < oldCap; i++) {
+            if(old[i].port == NN_PORT_CLOSEALL) continue;
+            nn_size_t j = (old[i].port * 2654435761u) & (cap - 1);
+            while(ports[j].port != NN_PORT_CLOSEALL) j = (j + 1) & (cap - 1);
+            ports[j] = old[i];
+        }
+        nn_dealloc(alloc, old, sizeof(nni_netPort) * oldCap);
+    }
+    nn_size_t mask = net->portCap - 1;
+    nn_size_t i = (port * 2654435761u) & mask;
+    while(net->ports[i].port != NN_PORT_CLOSEALL) i = (i + 1) & mask;
+    p = &net->ports[i];
+    p->port = port;
+    p->listeners = NULL;
+    p->len = 0;
+    p->cap = 0;
+    net->portLen++;
+    return p;
+}
+
+static nn_bool_t nni_network_listen(nni_network *net, nni_netEndpoint *ep, nn_size_t port) {
+    nni_netPort *p = nni_network_addPort(net, port);
+    if(p == NULL) return false;
+    if(p->len == p->cap) {
+        nn_size_t cap = p->cap * 2;
+        if(cap < 4) cap = 4;
+        nni_netEndpoint **listeners = nn_resize(&net->ctx.allocator, p->listeners, sizeof(nni_netEndpoint *) * p->cap, sizeof(nni_netEndpoint *) * cap);
+        if(listeners == NULL) return false;
+        p->listeners = listeners;
+        p->cap = cap;
+    }
+    p->listeners[p->len] = ep;
+    p->len++;
+    return true;
+}
+
+static void nni_network_unlisten(nni_network *net, nni_netEndpoint *ep, nn_size_t port) {
+    nni_netPort *p = nni_network_findPort(net, port);
+    if(p == NULL) return;
+    for(nn_size_t i = 0; i < p->len; i++) {
+        if(p->listeners[i] == ep) {
+            // order doesn't matter
+            p->len--;
+            p->listeners[i] = p->listeners[p->len];
+            return;
+        }
+    }
+}
+
+static nn_bool_t nni_network_reaches(nni_netEndpoint *from, nni_netEndpoint *to, double *distance) {
+    if(from == to) return false;
+    if(from->segment != 0 && from->segment == to->segment) {
+        *distance = 0;
+        return true;
+    }
+    if(!from->wireless || !to->wireless) return false;
+    double dx = from->x - to->x;
+    double dy = from->y - to->y;
+    double dz = from->z - to->z;
+    double d2 = dx * dx + dy * dy + dz * dz;
+    if(d2 > from->strength * from->strength) return false;
+    *distance = nni_network_sqrt(d2);
+    return true;
+}
+
+static nn_bool_t nni_network_addWaker(nni_network *net, nni_netEndpoint *ep) {
+    if(net->wakerLen == net->wakerCap) {
+        nn_size_t cap = net->wakerCap * 2;
+        if(cap < 16) cap = 16;
+        nni_netEndpoint **wakers = nn_resize(&net->ctx.allocator, net->wakers, sizeof(nni_netEndpoint *) * net->wakerCap, sizeof(nni_netEndpoint *) * cap);
+        if(wakers == NULL) return false;
+        net->wakers = wakers;
+        net->wakerCap = cap;
+    }
+    ep->wakerIdx = net->wakerLen;
+    net->wakers[net->wakerLen] = ep;
+    net->wakerLen++;
+    return true;
+}
+
+static void nni_network_removeWaker(nni_network *net, nni_netEndpoint *ep) {
+    nni_netEndpoint *last = net->wakers[net->wakerLen - 1];
+    net->wakers[ep->wakerIdx] = last;
+    last->wakerIdx = ep->wakerIdx;
+    net->wakerLen--;
+}
+
+static void nni_network_wake(nni_netEndpoint *to, nn_packet *packet) {
+    if(to->computer == NULL || !to->dormant || to->wakeupLen == 0) return;
+    if(nn_wakeupMatches(packet->values, packet->len, to->wakeup, to->wakeupFuzzy)) {
+        nn_requestComputerWake(to->computer);
+    }
+}
+
+static void nni_network_deliver(nni_netEndpoint *to, nn_packet *packet, double distance) {
+    // its computer is gone, the modem is just waiting for its deinit
+    if(to->computer == NULL) return;
+    // nobody would read it, the inbox is thrown away on wake
+    if(to->dormant) return;
+    // Posted, not pushed, so we never wait on a computer which is ticking on another thread.
+    // Errors are discarded as packet loss.
+    nn_postPacket(to->computer, to->address, packet, distance);
+}
+
+void nni_network_forgetComputer(nni_network *net, nn_computer *computer) {
+    nn_lock(&net->ctx, net->lock);
+    for(nn_size_t i = 0; i < net->endpointLen; i++) {
+        if(net->endpoints[i]->computer == computer) net->endpoints[i]->computer = NULL;
+    }
+    nn_unlock(&net->ctx, net->lock);
+}
+
+void nni_network_setDormant(nni_network *net, nn_computer *computer, nn_bool_t dormant) {
+    nn_lock(&net->ctx, net->lock);
+    for(nn_size_t i = 0; i < net->endpointLen; i++) {
+        if(net->endpoints[i]->computer == computer) net->endpoints[i]->dormant = dormant;
+    }
+    nn_unlock(&net->ctx, net->lock);
+}
+
+static nn_bool_t nni_network_attach(nni_network *net, nni_netEndpoint *ep) {
+    nn_lock(&net->ctx, net->lock);
+    if(net->endpointLen == net->endpointCap) {
+        nn_size_t cap = net->endpointCap * 2;
+        if(cap < 16) cap = 16;
+        nni_netEndpoint **endpoints = nn_resize(&net->ctx.allocator, net->endpoints, sizeof(nni_netEndpoint *) * net->endpointCap, sizeof(nni_netEndpoint *) * cap);
+        if(endpoints == NULL) {
+            nn_unlock(&net->ctx, net->lock);
+            return false;
+        }
+        net->endpoints = endpoints;
+        net->endpointCap = cap;
+    }
+    ep->idx = net->endpointLen;
+    net->endpoints[net->endpointLen] = ep;
+    net->endpointLen++;
+    if(net->endpointLen * 2 > net->addressCap) {
+        // indexes us too
+        if(!nni_network_rebuildAddresses(net, net->endpointLen)) {
+            net->endpointLen--;
+            nn_unlock(&net->ctx, net->lock);
+            return false;
+        }
+    } else {
+        nni_network_indexAddress(net, ep);
+    }
+    nn_unlock(&net->ctx, net->lock);
+    return true;
+}
+
+static void nni_network_detach(nni_network *net, nni_netEndpoint *ep) {
+    nn_lock(&net->ctx, net->lock);
+    nn_size_t ports[ep->ports.max];
+    nn_size_t portCount = nn_portSet_getPorts(&ep->ports, ports);
+    for(nn_size_t i = 0; i < portCount; i++) {
+        nni_network_unlisten(net, ep, ports[i]);
+    }
+    if(ep->wakeupLen > 0) nni_network_removeWaker(net, ep);
+    nni_netEndpoint *last = net->endpoints[net->endpointLen - 1];
+    net->endpoints[ep->idx] = last;
+    last->idx = ep->idx;
+    net->endpointLen--;
+    // can't fail, the index is already big enough
+    nni_network_rebuildAddresses(net, net->endpointLen);
+    nn_unlock(&net->ctx, net->lock);
+}
+
+// the modem table
+
+static void nni_netModem_deinit(nni_netEndpoint *ep) {
+    if(ep->net != NULL) nni_network_detach(ep->net, ep);
+    nn_Alloc *alloc = &ep->ctx.allocator;
+    nn_deallocStr(alloc, ep->address);
+    nn_dealloc(alloc, ep, sizeof(nni_netEndpoint));
+}
+
+// the fabric reads our ports, position and strength while others send, so changes happen under its lock
+static void nni_netModem_lock(nni_netEndpoint *ep) {
+    if(ep->net != NULL) nn_lock(&ep->ctx, ep->net->lock);
+}
+
+static void nni_netModem_unlock(nni_netEndpoint *ep) {
+    if(ep->net != NULL) nn_unlock(&ep->ctx, ep->net->lock);
+}
+
+static nn_bool_t nni_netModem_isOpen(nni_netEndpoint *ep, nn_size_t port, nn_errorbuf_t err) {
+    return nn_portSet_isOpen(&ep->ports, port);
+}
+
+static nn_bool_t nni_netModem_open(nni_netEndpoint *ep, nn_size_t port, nn_errorbuf_t err) {
+    if(nn_portSet_isOpen(&ep->ports, port)) return false;
+    if(nn_portSet_isFull(&ep->ports)) {
+        nn_error_write(err, "too many open ports");
+        return false;
+    }
+    nni_netModem_lock(ep);
+    if(ep->net != NULL && !nni_network_listen(ep->net, ep, port)) {
+        nni_netModem_unlock(ep);
+        nn_error_write(err, "out of memory");
+        return false;
+    }
+    nn_portSet_open(&ep->ports, port);
+    nni_netModem_unlock(ep);
+    return true;
+}
+
+static nn_bool_t nni_netModem_close(nni_netEndpoint *ep, nn_size_t port, nn_errorbuf_t err) {
+    nn_size_t ports[ep->ports.max];
+    nn_size_t portCount = 1;
+    if(port == NN_PORT_CLOSEALL) {
+        portCount = nn_portSet_getPorts(&ep->ports, ports);
+    } else if(nn_portSet_isOpen(&ep->ports, port)) {
+        ports[0] = port;
+    } else {
+        nn_error_write(err, "port already closed");
+        return false;
+    }
+    nni_netModem_lock(ep);
+    for(nn_size_t i = 0; i < portCount; i++) {
+        if(ep->net != NULL) nni_network_unlisten(ep->net, ep, ports[i]);
+        nn_portSet_close(&ep->ports, ports[i]);
+    }
+    nni_netModem_unlock(ep);
+    return true;
+}
+
+static nn_size_t nni_netModem_getPorts(nni_netEndpoint *ep, nn_size_t *ports, nn_errorbuf_t err) {
+    return nn_portSet_getPorts(&ep->ports, ports);
+}
+
+static nn_bool_t nni_netModem_sendPacket(nni_netEndpoint *ep, nn_address address, nn_packet *packet, nn_errorbuf_t err) {
+    nni_network *net = ep->net;
+    // unplugged from a dead universe, nothing hears us
+    if(net == NULL) return true;
+    nn_size_t port = packet->port;
+
+    double distance;
+    nn_lock(&net->ctx, net->lock);
+    if(address != NULL) {
+        nni_netEndpoint *to = nni_network_findAddress(net, address);
+        if(to != NULL && nni_network_reaches(ep, to, &distance)) {
+            nni_network_wake(to, packet);
+            if(nn_portSet_isOpen(&to->ports, port)) nni_network_deliver(to, packet, distance);
+        }
+    } else {
+        nni_netPort *p = nni_network_findPort(net, port);
+        for(nn_size_t i = 0; p != NULL && i < p->len; i++) {
+            nni_netEndpoint *to = p->listeners[i];
+            if(nni_network_reaches(ep, to, &distance)) {
+                nni_network_deliver(to, packet, distance);
+            }
+        }
+        // wake messages work on any port, open or not
+        for(nn_size_t i = 0; i < net->wakerLen; i++) {
+            nni_netEndpoint *to = net->wakers[i];
+            if(to->dormant && nni_network_reaches(ep, to, &distance)) {
+                nni_network_wake(to, packet);
+            }
+        }
+    }
+    nn_unlock(&net->ctx, net->lock);
+    return true;
+}
+
+// for hosts calling the table themselves, the modem component uses sendPacket
+static nn_bool_t nni_netModem_send(nni_netEndpoint *ep, nn_address address, nn_size_t port, nn_value *values, nn_size_t valuec, nn_errorbuf_t err) {
+    nn_size_t size = nn_measurePacketSize(values, valuec);
+    // tables and arrays
+    if(size == (nn_size_t)-1) {
+        nn_error_write(err, "unsupported data type");
+        return false;
+    }
+    nn_packet *packet = nn_newMeasuredPacket(&ep->ctx.allocator, ep->address, port, values, valuec, size);
+    if(packet == NULL) {
+        nn_error_write(err, "out of memory");
+        return false;
+    }
+    nn_bool_t res = nni_netModem_sendPacket(ep, address, packet, err);
+    nn_dropPacket(packet);
+    return res;
+}
+
+static double nni_netModem_getStrength(nni_netEndpoint *ep, nn_errorbuf_t err) {
+    return ep->strength;
+}
+
+static double nni_netModem_setStrength(nni_netEndpoint *ep, double n, nn_errorbuf_t err) {
+    nni_netModem_lock(ep);
+    ep->strength = n;
+    nni_netModem_unlock(ep);
+    return n;
+}
+
+static nn_size_t nni_netModem_getWakeMessage(nni_netEndpoint *ep, char *msg, nn_errorbuf_t err) {
+    nn_memcpy(msg, ep->wakeup, ep->wakeupLen);
+    return ep->wakeupLen;
+}
+
+static nn_size_t nni_netModem_setWakeMessage(nni_netEndpoint *ep, const char *msg, nn_size_t msglen, nn_bool_t fuzzy, nn_errorbuf_t err) {
+    nni_netModem_lock(ep);
+    if(ep->net != NULL && ep->wakeupLen == 0 && msglen > 0 && !nni_network_addWaker(ep->net, ep)) {
+        nni_netModem_unlock(ep);
+        nn_error_write(err, "out of memory");
+        return 0;
+    }
+    if(ep->net != NULL && ep->wakeupLen > 0 && msglen == 0) nni_network_removeWaker(ep->net, ep);
+    ep->wakeupLen = msglen;
+    ep->wakeupFuzzy = fuzzy;
+    nn_memcpy(ep->wakeup, msg, msglen);
+    ep->wakeup[msglen] = '\0';
+    nni_netModem_unlock(ep);
+    return msglen;
+}
+
+nn_modem *nn_networkModem(nn_Context *context, nn_networkModemOpts opts, nn_networkControl control) {
+    nn_Alloc *alloc = &context->allocator;
+    nni_network *net = nn_getUniverse(opts.computer)->network;
+
+    nni_netEndpoint *ep = nn_alloc(alloc, sizeof(nni_netEndpoint));
+    if(ep == NULL) return NULL;
+    ep->net = net;
+    ep->ctx = *context;
+    ep->computer = opts.computer;
+    ep->address = nn_strdup(alloc, opts.address);
+    if(ep->address == NULL) {
+        nn_dealloc(alloc, ep, sizeof(nni_netEndpoint));
+        return NULL;
+    }
+    nn_portSet_init(&ep->ports, opts.maxOpenPorts);
+    ep->segment = opts.segment;
+    ep->wireless = opts.isWireless;
+    ep->x = opts.x;
+    ep->y = opts.y;
+    ep->z = opts.z;
+    ep->strength = opts.maxStrength;
+    ep->maxStrength = opts.maxStrength;
+    ep->wakeupLen = 0;
+    ep->wakeupFuzzy = false;
+    ep->dormant = nn_isComputerDormant(opts.computer);
+
+    if(!nni_network_attach(net, ep)) {
+        ep->net = NULL;
+        nni_netModem_deinit(ep);
+        return NULL;
+    }
+
+    nn_modemTable table = {
+        .userdata = ep,
+        .deinit = (void *)nni_netModem_deinit,
+
+        .wireless = opts.isWireless,
+        .maxValues = opts.maxValues,
+        .maxOpenPorts = opts.maxOpenPorts,
+        .maxPacketSize = opts.maxPacketSize,
+
+        .isOpen = (void *)nni_netModem_isOpen,
+        .open = (void *)nni_netModem_open,
+        .close = (void *)nni_netModem_close,
+        .getPorts = (void *)nni_netModem_getPorts,
+
+        .send = (void *)nni_netModem_send,
+        .sendPacket = (void *)nni_netModem_sendPacket,
+
+        .maxStrength = opts.maxStrength,
+        .getStrength = (void *)nni_netModem_getStrength,
+        .setStrength = (void *)nni_netModem_setStrength,
+
+        .setWakeMessage = (void *)nni_netModem_setWakeMessage,
+        .getWakeMessage = (void *)nni_netModem_getWakeMessage,
+    };
+    nn_modem *m = nn_newModem(context, table, control);
+    if(m == NULL) nni_netModem_deinit(ep);
+    return m;
+}
+
+static nni_netEndpoint *nni_netModem_endpoint(nn_modem *modem) {
+    nn_modemTable *table = nn_getModemTable(modem);
+    // not one of ours
+    if(table->send != (void *)nni_netModem_send) return NULL;
+    return table->userdata;
+}
+
+nn_bool_t nn_moveNetworkModem(nn_modem *modem, double x, double y, double z) {
+    nni_netEndpoint *ep = nni_netModem_endpoint(modem);
+    if(ep == NULL) return false;
+    nni_netModem_lock(ep);
+    ep->x = x;
+    ep->y = y;
+    ep->z = z;
+    nni_netModem_unlock(ep);
+    return true;
+}
+
+nn_bool_t nn_setNetworkModemSegment(nn_modem *modem, nn_size_t segment) {
+    nni_netEndpoint *ep = nni_netModem_endpoint(modem);
+    if(ep == NULL) return false;
+    nni_netModem_lock(ep);
+    ep->segment = segment;
+    nni_netModem_unlock(ep);
+    return true;
+}
@@ -228,6 +228,8 @@ local libcomputer = {
         local deadline = computer.uptime() + (type(timeout) == "number" and timeout or math.huge)
 
         repeat
+            -- don't get resumed until there is a signal or we run out of time
+            computer.sleep(deadline - computer.uptime())
             yield() -- give executor a chance to give us stuff
             local s = table.pack(computer.popSignal())
             if s.n > 0 then
@@ -0,0 +1,344 @@
+#include "neonucleus.h"
+#include "universe.h"
+#include "computer.h"
+
+// The universe tick scheduler.
+// Every worker owns a contiguous range of the computer list, packed as [head, tail) into one atomic.
+// Owners pop from the head, and once they run dry they steal the back half of someone else's range.
+// Nothing adds work during a tick, so a worker which finds every range empty can just go home.
+
+typedef struct nni_tickJob {
+    nn_universe *universe;
+    nn_universe_tickCallback *callback;
+    void *userdata;
+} nni_tickJob;
+
+typedef enum nni_tickResult {
+    NNI_TICKED,
+    NNI_TICK_SLEPT,
+    // deleted earlier this tick, just waiting for the sweep
+    NNI_TICK_DOOMED,
+} nni_tickResult;
+
+// the callback is only called if the computer was actually ticked
+static nni_tickResult nni_scheduler_tickOne(nni_tickJob *job, nn_computer *computer, double *time) {
+    nn_universe *universe = job->universe;
+    double start = nn_getTime(universe);
+    nn_lock(&universe->ctx, computer->lock);
+    if(computer->deleteLater) {
+        nn_unlock(&universe->ctx, computer->lock);
+        return NNI_TICK_DOOMED;
+    }
+    if(nn_isComputerSleeping(computer)) {
+        nn_unlock(&universe->ctx, computer->lock);
+        return NNI_TICK_SLEPT;
+    }
+    int state = nn_tickComputer(computer);
+    if(job->callback != NULL) {
+        job->callback(job->userdata, computer, state);
+    }
+    nn_unlock(&universe->ctx, computer->lock);
+    *time = nn_getTime(universe) - start;
+    return NNI_TICKED;
+}
+
+static void nni_scheduler_tickSerial(nni_tickJob *job, nn_tickStats *stats) {
+    nn_universe *universe = job->universe;
+    for(nn_size_t i = 0; i < universe->computerLen; i++) {
+        double t;
+        nni_tickResult result = nni_scheduler_tickOne(job, universe->computers[i], &t);
+        if(result == NNI_TICK_SLEPT) stats->computersSleeping++;
+        if(result != NNI_TICKED) continue;
+        if(t > stats->slowestComputer) stats->slowestComputer = t;
+        stats->computersTicked++;
+    }
+}
+
+#ifndef NN_BAREMETAL
+#include "tinycthread.h"
+#include <stdatomic.h>
+
+#define NNI_RANGE(head, tail) (((unsigned long long)(tail) << 32) | (unsigned long long)(head))
+#define NNI_RANGE_HEAD(range) ((nn_size_t)((range) & 0xFFFFFFFF))
+#define NNI_RANGE_TAIL(range) ((nn_size_t)((range) >> 32))
+
+typedef struct nni_worker {
+    _Atomic(unsigned long long) range;
+    struct nni_scheduler *scheduler;
+    nn_size_t id;
+    thrd_t thread;
+    nn_size_t ticked;
+    nn_size_t sleeping;
+    nn_size_t steals;
+    double slowest;
+    // keeps the hot range of 2 workers off the same cache line
+    char padding[64];
+} nni_worker;
+
+typedef struct nni_scheduler {
+    nn_Context ctx;
+    nni_worker *workers;
+    nn_size_t workerCount;
+    mtx_t mutex;
+    cnd_t wake;
+    cnd_t done;
+    nn_size_t generation;
+    nn_size_t pending;
+    nn_bool_t quitting;
+    nni_tickJob job;
+} nni_scheduler;
+
+static nn_bool_t nni_worker_pop(nni_worker *worker, nn_size_t *idx) {
+    unsigned long long range = worker->range;
+    while(true) {
+        nn_size_t head = NNI_RANGE_HEAD(range);
+        nn_size_t tail = NNI_RANGE_TAIL(range);
+        if(head >= tail) return false;
+        // on failure, range is reloaded for us
+        if(atomic_compare_exchange_weak(&worker->range, &range, NNI_RANGE(head + 1, tail))) {
+            *idx = head;
+            return true;
+        }
+    }
+}
+
+static nn_bool_t nni_worker_steal(nni_worker *worker) {
+    nni_scheduler *s = worker->scheduler;
+    for(nn_size_t i = 1; i < s->workerCount; i++) {
+        nni_worker *victim = &s->workers[(worker->id + i) % s->workerCount];
+        unsigned long long range = victim->range;
+        while(true) {
+            nn_size_t head = NNI_RANGE_HEAD(range);
+            nn_size_t tail = NNI_RANGE_TAIL(range);
+            if(head >= tail) break;
+            nn_size_t taken = (tail - head + 1) / 2;
+            if(atomic_compare_exchange_weak(&victim->range, &range, NNI_RANGE(head, tail - taken))) {
+                // our range is empty, and nobody can CAS an empty range, so a plain store is fine
+                worker->range = NNI_RANGE(tail - taken, tail);
+                worker->steals++;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static void nni_worker_run(nni_worker *worker) {
+    nni_tickJob *job = &worker->scheduler->job;
+    nn_size_t idx;
+    while(true) {
+        if(nni_worker_pop(worker, &idx)) {
+            double t;
+            nni_tickResult result = nni_scheduler_tickOne(job, job->universe->computers[idx], &t);
+            if(result == NNI_TICK_SLEPT) worker->sleeping++;
+            if(result != NNI_TICKED) continue;
+            if(t > worker->slowest) worker->slowest = t;
+            worker->ticked++;
+            continue;
+        }
+        if(!nni_worker_steal(worker)) break;
+    }
+}
+
+static int nni_worker_main(void *data) {
+    nni_worker *worker = data;
+    nni_scheduler *s = worker->scheduler;
+    nn_size_t seen = 0;
+
+    mtx_lock(&s->mutex);
+    while(true) {
+        while(s->generation == seen && !s->quitting) {
+            cnd_wait(&s->wake, &s->mutex);
+        }
+        if(s->quitting) break;
+        seen = s->generation;
+        mtx_unlock(&s->mutex);
+
+        nni_worker_run(worker);
+
+        mtx_lock(&s->mutex);
+        s->pending--;
+        if(s->pending == 0) cnd_signal(&s->done);
+    }
+    mtx_unlock(&s->mutex);
+    return 0;
+}
+
+// stops the first count helper threads and frees everything
+static void nni_scheduler_free(nni_scheduler *s, nn_size_t count) {
+    mtx_lock(&s->mutex);
+    s->quitting = true;
+    cnd_broadcast(&s->wake);
+    mtx_unlock(&s->mutex);
+
+    // worker 0 is the thread calling tickAll, it has no thread of its own
+    for(nn_size_t i = 1; i <= count; i++) {
+        thrd_join(s->workers[i].thread, NULL);
+    }
+
+    cnd_destroy(&s->done);
+    cnd_destroy(&s->wake);
+    mtx_destroy(&s->mutex);
+
+    nn_Alloc *alloc = &s->ctx.allocator;
+    nn_dealloc(alloc, s->workers, sizeof(nni_worker) * s->workerCount);
+    nn_dealloc(alloc, s, sizeof(nni_scheduler));
+}
+
+static nni_scheduler *nni_scheduler_new(nn_Context *ctx, nn_size_t workerCount) {
+    nn_Alloc *alloc = &ctx->allocator;
+    nni_scheduler *s = nn_alloc(alloc, sizeof(nni_scheduler));
+    if(s == NULL) return NULL;
+    s->ctx = *ctx;
+    s->workerCount = workerCount;
+    s->workers = nn_alloc(alloc, sizeof(nni_worker) * workerCount);
+    if(s->workers == NULL) {
+        nn_dealloc(alloc, s, sizeof(nni_scheduler));
+        return NULL;
+    }
+    s->generation = 0;
+    s->pending = 0;
+    s->quitting = false;
+    mtx_init(&s->mutex, mtx_plain);
+    cnd_init(&s->wake);
+    cnd_init(&s->done);
+
+    for(nn_size_t i = 0; i < workerCount; i++) {
+        nni_worker *worker = &s->workers[i];
+        worker->range = NNI_RANGE(0, 0);
+        worker->scheduler = s;
+        worker->id = i;
+        if(i == 0) continue;
+        if(thrd_create(&worker->thread, nni_worker_main, worker) != thrd_success) {
+            nni_scheduler_free(s, i - 1);
+            return NULL;
+        }
+    }
+    return s;
+}
+
+static void nni_scheduler_tickParallel(nni_scheduler *s, nni_tickJob *job, nn_tickStats *stats) {
+    nn_size_t count = job->universe->computerLen;
+
+    s->job = *job;
+    for(nn_size_t i = 0; i < s->workerCount; i++) {
+        nni_worker *worker = &s->workers[i];
+        worker->range = NNI_RANGE(count * i / s->workerCount, count * (i + 1) / s->workerCount);
+        worker->ticked = 0;
+        worker->sleeping = 0;
+        worker->steals = 0;
+        worker->slowest = 0;
+    }
+
+    mtx_lock(&s->mutex);
+    s->pending = s->workerCount - 1;
+    s->generation++;
+    cnd_broadcast(&s->wake);
+    mtx_unlock(&s->mutex);
+
+    // we're a worker too
+    nni_worker_run(&s->workers[0]);
+
+    mtx_lock(&s->mutex);
+    while(s->pending > 0) {
+        cnd_wait(&s->done, &s->mutex);
+    }
+    mtx_unlock(&s->mutex);
+
+    for(nn_size_t i = 0; i < s->workerCount; i++) {
+        nni_worker *worker = &s->workers[i];
+        stats->computersTicked += worker->ticked;
+        stats->computersSleeping += worker->sleeping;
+        stats->steals += worker->steals;
+        if(worker->slowest > stats->slowestComputer) stats->slowestComputer = worker->slowest;
+    }
+}
+
+#endif
+
+nn_bool_t nn_universe_setWorkerCount(nn_universe *universe, nn_size_t workerCount) {
+    nn_lock(&universe->ctx, universe->computerLock);
+    nni_scheduler_destroy(universe);
+    if(workerCount <= 1) {
+        nn_unlock(&universe->ctx, universe->computerLock);
+        return true;
+    }
+#ifdef NN_BAREMETAL
+    nn_unlock(&universe->ctx, universe->computerLock);
+    return false;
+#else
+    // ranges are packed as 2 32-bit halves
+    if(workerCount > 0xFFFF) workerCount = 0xFFFF;
+    universe->scheduler = nni_scheduler_new(&universe->ctx, workerCount);
+    nn_unlock(&universe->ctx, universe->computerLock);
+    return universe->scheduler != NULL;
+#endif
+}
+
+nn_size_t nn_universe_getWorkerCount(nn_universe *universe) {
+#ifndef NN_BAREMETAL
+    if(universe->scheduler != NULL) return universe->scheduler->workerCount;
+#endif
+    return 1;
+}
+
+void nni_scheduler_destroy(nn_universe *universe) {
+#ifndef NN_BAREMETAL
+    if(universe->scheduler == NULL) return;
+    nni_scheduler_free(universe->scheduler, universe->scheduler->workerCount - 1);
+    universe->scheduler = NULL;
+#endif
+}
+
+// does the removals and deletions asked for during the tick
+static void nni_scheduler_sweep(nn_universe *universe) {
+    // backwards, so a swap remove only moves in computers we already looked at
+    nn_size_t i = universe->computerLen;
+    while(i > 0) {
+        i--;
+        nn_computer *computer = universe->computers[i];
+        if(computer->deleteLater) {
+            nn_deleteComputer(computer);
+        } else if(computer->removeLater) {
+            computer->removeLater = false;
+            nn_universe_removeComputer(universe, computer);
+        }
+    }
+}
+
+void nn_universe_tickAll(nn_universe *universe, nn_universe_tickCallback *callback, void *userdata, nn_tickStats *stats) {
+    nn_tickStats localStats;
+    if(stats == NULL) stats = &localStats;
+    stats->wallTime = 0;
+    stats->slowestComputer = 0;
+    stats->computersTicked = 0;
+    stats->computersSleeping = 0;
+    stats->steals = 0;
+
+    nni_tickJob job = {
+        .universe = universe,
+        .callback = callback,
+        .userdata = userdata,
+    };
+
+    double start = nn_getTime(universe);
+    // the list can't change under our feet
+    nn_lock(&universe->ctx, universe->computerLock);
+    universe->ticking = true;
+#ifndef NN_BAREMETAL
+    // not worth waking everyone up for a couple computers
+    if(universe->scheduler != NULL && universe->computerLen > 1) {
+        nni_scheduler_tickParallel(universe->scheduler, &job, stats);
+    } else {
+        nni_scheduler_tickSerial(&job, stats);
+    }
+#else
+    nni_scheduler_tickSerial(&job, stats);
+#endif
+    universe->ticking = false;
+    nni_scheduler_sweep(universe);
+    nn_unlock(&universe->ctx, universe->computerLock);
+
+    stats->wallTime = nn_getTime(universe) - start;
+    universe->lastTickTime = stats->wallTime;
+}
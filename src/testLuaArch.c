@@ -87,9 +87,8 @@ nn_computer *testLuaArch_getComputer(lua_State *L) {
     return testLuaArch_get(L)->computer;
 }
 
-static nn_value testLuaArch_getValue(lua_State *L, int index) {
+static nn_value testLuaArch_getValue(lua_State *L, int index, nn_Alloc *alloc) {
     int type = lua_type(L, index);
-    nn_Alloc *alloc = testLuaArch_getAlloc(L);
     
     if(type == LUA_TBOOLEAN) {
         return nn_values_boolean(lua_toboolean(L, index));
@@ -308,7 +307,7 @@ static int testLuaArch_computer_pushSignal(lua_State *L) {
     if(argc > NN_MAX_ARGS) luaL_error(L, "too many arguments");
     nn_value args[argc];
     for(size_t i = 0; i < argc; i++) {
-        args[i] = testLuaArch_getValue(L, i+1);
+        args[i] = testLuaArch_getValue(L, i+1, testLuaArch_getAlloc(L));
     }
     const char *err = nn_pushSignal(c, args, argc);
     if(err != NULL) {
@@ -331,6 +330,12 @@ static int testLuaArch_computer_popSignal(lua_State *L) {
     return retc;
 }
 
+static int testLuaArch_computer_sleep(lua_State *L) {
+    nn_computer *c = testLuaArch_getComputer(L);
+    nn_sleepComputer(c, luaL_checknumber(L, 1));
+    return 0;
+}
+
 static int testLuaArch_computer_users(lua_State *L) {
     nn_computer *c = testLuaArch_getComputer(L);
     size_t i = 0;
@@ -492,11 +497,20 @@ static int testLuaArch_component_invoke(lua_State *L) {
         lua_pushstring(L, "no such component");
         return 2;
     }
+    // resolve it before we bother converting arguments
+    size_t methodId = nn_findMethod(nn_getComponentTable(component), method);
+    if(methodId == NN_METHOD_NONE) {
+        lua_pushnil(L);
+        lua_pushstring(L, "no such method");
+        return 2;
+    }
     nn_resetCall(c);
+    // arguments only live for the call, so they go in the call arena
+    nn_Alloc *callAlloc = nn_getCallAllocator(c);
     for(size_t i = 0; i < argc; i++) {
-        nn_addArgument(c, testLuaArch_getValue(L, 3 + i));
+        nn_addArgument(c, testLuaArch_getValue(L, 3 + i, callAlloc));
     }
-    if(!nn_invokeComponentMethod(component, method)) {
+    if(!nn_invokeComponentMethodById(component, methodId)) {
         nn_resetCall(c);
         lua_pushnil(L);
         lua_pushstring(L, "no such method");
@@ -639,6 +653,8 @@ void testLuaArch_loadEnv(lua_State *L) {
     lua_setfield(L, computer, "pushSignal");
     lua_pushcfunction(L, testLuaArch_computer_popSignal);
     lua_setfield(L, computer, "popSignal");
+    lua_pushcfunction(L, testLuaArch_computer_sleep);
+    lua_setfield(L, computer, "sleep");
     lua_pushcfunction(L, testLuaArch_computer_users);
     lua_setfield(L, computer, "users");
     lua_pushcfunction(L, testLuaArch_computer_getState);
@@ -1,5 +1,6 @@
 #include "neonucleus.h"
 #include "universe.h"
+#include "computer.h"
 
 nn_universe *nn_newUniverse(nn_Context ctx) {
     nn_universe *u = nn_alloc(&ctx.allocator, sizeof(nn_universe));
@@ -7,6 +8,23 @@ nn_universe *nn_newUniverse(nn_Context ctx) {
     u->ctx = ctx;
     // we leave udata uninitialized because it does not matter
     u->udataLen = 0;
+    u->computerLock = nn_newGuard(&ctx);
+    if(u->computerLock == NULL) {
+        nn_dealloc(&ctx.allocator, u, sizeof(nn_universe));
+        return NULL;
+    }
+    u->computers = NULL;
+    u->computerLen = 0;
+    u->computerCap = 0;
+    u->scheduler = NULL;
+    u->ticking = false;
+    u->lastTickTime = 0;
+    u->network = nni_network_new(&ctx);
+    if(u->network == NULL) {
+        nn_deleteGuard(&ctx, u->computerLock);
+        nn_dealloc(&ctx.allocator, u, sizeof(nn_universe));
+        return NULL;
+    }
     return u;
 }
 
@@ -31,6 +49,14 @@ nn_Rng *nn_getRng(nn_universe *universe) {
 }
 
 void nn_unsafeDeleteUniverse(nn_universe *universe) {
+    nni_scheduler_destroy(universe);
+    // computers are owned by the host, we just forget about them
+    for(nn_size_t i = 0; i < universe->computerLen; i++) {
+        universe->computers[i]->scheduled = false;
+    }
+    nn_dealloc(&universe->ctx.allocator, universe->computers, sizeof(nn_computer *) * universe->computerCap);
+    nn_deleteGuard(&universe->ctx, universe->computerLock);
+    nni_network_free(universe->network);
     for(nn_size_t i = 0; i < universe->udataLen; i++) {
         nn_deallocStr(&universe->ctx.allocator, universe->udata[i].name);
     }
@@ -62,6 +88,73 @@ double nn_getTime(nn_universe *universe) {
     return universe->ctx.clock.proc(universe->ctx.clock.userdata);
 }
 
+nn_bool_t nn_universe_addComputer(nn_universe *universe, nn_computer *computer) {
+    nn_Alloc *alloc = &universe->ctx.allocator;
+    nn_lock(&universe->ctx, universe->computerLock);
+    if(computer->scheduled) {
+        // it may have asked to be removed this tick, which we take back
+        computer->removeLater = false;
+        nn_unlock(&universe->ctx, universe->computerLock);
+        return true;
+    }
+    // growing the list could move it under the workers
+    if(universe->ticking) {
+        nn_unlock(&universe->ctx, universe->computerLock);
+        return false;
+    }
+    if(universe->computerLen == universe->computerCap) {
+        nn_size_t cap = universe->computerCap * 2;
+        if(cap < 16) cap = 16;
+        nn_computer **computers = nn_resize(alloc, universe->computers, sizeof(nn_computer *) * universe->computerCap, sizeof(nn_computer *) * cap);
+        if(computers == NULL) {
+            nn_unlock(&universe->ctx, universe->computerLock);
+            return false;
+        }
+        universe->computers = computers;
+        universe->computerCap = cap;
+    }
+    computer->scheduled = true;
+    computer->scheduleIdx = universe->computerLen;
+    universe->computers[universe->computerLen] = computer;
+    universe->computerLen++;
+    nn_unlock(&universe->ctx, universe->computerLock);
+    return true;
+}
+
+void nn_universe_removeComputer(nn_universe *universe, nn_computer *computer) {
+    if(universe->ticking) {
+        // the workers are still walking the list, nn_universe_tickAll() removes it once they're done
+        if(computer->scheduled) computer->removeLater = true;
+        return;
+    }
+    nn_lock(&universe->ctx, universe->computerLock);
+    if(!computer->scheduled) {
+        nn_unlock(&universe->ctx, universe->computerLock);
+        return;
+    }
+    // swap remove, order doesn't matter
+    nn_size_t idx = computer->scheduleIdx;
+    nn_computer *last = universe->computers[universe->computerLen - 1];
+    universe->computers[idx] = last;
+    last->scheduleIdx = idx;
+    universe->computerLen--;
+    computer->scheduled = false;
+    nn_unlock(&universe->ctx, universe->computerLock);
+}
+
+nn_size_t nn_universe_getComputerCount(nn_universe *universe) {
+    return universe->computerLen;
+}
+
+nn_computer *nn_universe_getComputer(nn_universe *universe, nn_size_t idx) {
+    if(idx >= universe->computerLen) return NULL;
+    return universe->computers[idx];
+}
+
+double nn_universe_getLastTickTime(nn_universe *universe) {
+    return universe->lastTickTime;
+}
+
 void nn_loadCoreComponentTables(nn_universe *universe) {
     nn_loadEepromTable(universe);
     nn_loadFilesystemTable(universe);
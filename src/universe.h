@@ -8,10 +8,35 @@ typedef struct nn_universe_udata {
     void *userdata;
 } nn_universe_udata;
 
+typedef struct nni_scheduler nni_scheduler;
+typedef struct nni_network nni_network;
+
 typedef struct nn_universe {
     nn_Context ctx;
     nn_universe_udata udata[NN_MAX_USERDATA];
     nn_size_t udataLen;
+    // computers ticked by nn_universe_tickAll
+    nn_guard *computerLock;
+    nn_computer **computers;
+    nn_size_t computerLen;
+    nn_size_t computerCap;
+    // NULL when ticking on the calling thread only
+    nni_scheduler *scheduler;
+    // true during nn_universe_tickAll(), the list must not change then
+    nn_bool_t ticking;
+    double lastTickTime;
+    // where network modems talk to each other
+    nni_network *network;
 } nn_universe;
 
+// stops and frees the worker pool, if any
+void nni_scheduler_destroy(nn_universe *universe);
+
+nni_network *nni_network_new(nn_Context *ctx);
+void nni_network_free(nni_network *net);
+// the computer is being deleted, its modems stop receiving
+void nni_network_forgetComputer(nni_network *net, nn_computer *computer);
+// dormant computers only hear wake messages
+void nni_network_setDormant(nni_network *net, nn_computer *computer, nn_bool_t dormant);
+
 #endif
@@ -38,6 +38,150 @@ void nn_dealloc(nn_Alloc *alloc, void *memory, nn_size_t size) {
     alloc->proc(alloc->userdata, memory, size, 0, NULL);
 }
 
+// Arenas
+// Small allocations are bumped out of a list of chunks, which survive resets.
+// Anything bigger than half a chunk gets its own block, which is freed on reset.
+
+#define NNI_ARENA_ALIGN 16
+#define NNI_ARENA_ALIGNUP(x) (((x) + NNI_ARENA_ALIGN - 1) & ~(nn_size_t)(NNI_ARENA_ALIGN - 1))
+
+typedef struct nni_arenaChunk {
+    struct nni_arenaChunk *next;
+    nn_size_t size;
+    nn_size_t used;
+} nni_arenaChunk;
+
+#define NNI_ARENA_HEADER NNI_ARENA_ALIGNUP(sizeof(nni_arenaChunk))
+#define NNI_ARENA_DATA(chunk) ((char *)(chunk) + NNI_ARENA_HEADER)
+
+typedef struct nn_arena {
+    nn_Alloc backing;
+    nn_size_t chunkSize;
+    nni_arenaChunk *chunks;
+    nni_arenaChunk *current;
+    nni_arenaChunk *large;
+    // the last allocation, so it can be resized or freed in place
+    char *last;
+    nn_size_t lastOffset;
+} nn_arena;
+
+static void *nni_arena_bump(nn_arena *arena, nn_size_t size) {
+    nn_size_t aligned = NNI_ARENA_ALIGNUP(size);
+    if(aligned > arena->chunkSize / 2) {
+        nni_arenaChunk *big = nn_alloc(&arena->backing, NNI_ARENA_HEADER + size);
+        if(big == NULL) return NULL;
+        big->size = size;
+        big->used = size;
+        big->next = arena->large;
+        arena->large = big;
+        arena->last = NULL;
+        return NNI_ARENA_DATA(big);
+    }
+    nni_arenaChunk *c = arena->current;
+    while(c == NULL || c->used + aligned > c->size) {
+        // chunks past the current one are empty
+        if(c != NULL && c->next != NULL) {
+            c = c->next;
+            continue;
+        }
+        nni_arenaChunk *fresh = nn_alloc(&arena->backing, NNI_ARENA_HEADER + arena->chunkSize);
+        if(fresh == NULL) return NULL;
+        fresh->next = NULL;
+        fresh->size = arena->chunkSize;
+        fresh->used = 0;
+        if(c == NULL) arena->chunks = fresh;
+        else c->next = fresh;
+        c = fresh;
+    }
+    arena->current = c;
+    arena->lastOffset = c->used;
+    arena->last = NNI_ARENA_DATA(c) + c->used;
+    c->used += aligned;
+    return arena->last;
+}
+
+static void *nni_arenaProc(void *userdata, void *ptr, nn_size_t oldSize, nn_size_t newSize, void *extra) {
+    nn_arena *arena = userdata;
+    nn_bool_t isLast = ptr != NULL && ptr == arena->last;
+    if(newSize == 0) {
+        // only the last allocation can actually be given back
+        if(isLast) {
+            arena->current->used = arena->lastOffset;
+            arena->last = NULL;
+        }
+        return NULL;
+    }
+    // shrinking never needs to move, we just waste the tail
+    if(!isLast && ptr != NULL && newSize <= oldSize) return ptr;
+    if(isLast && arena->lastOffset + NNI_ARENA_ALIGNUP(newSize) <= arena->current->size) {
+        arena->current->used = arena->lastOffset + NNI_ARENA_ALIGNUP(newSize);
+        return ptr;
+    }
+    void *mem = nni_arena_bump(arena, newSize);
+    if(mem != NULL && ptr != NULL) {
+        nn_memcpy(mem, ptr, oldSize < newSize ? oldSize : newSize);
+    }
+    return mem;
+}
+
+nn_arena *nn_newArena(nn_Alloc *backing, nn_size_t chunkSize) {
+    nn_arena *arena = nn_alloc(backing, sizeof(nn_arena));
+    if(arena == NULL) return NULL;
+    arena->backing = *backing;
+    arena->chunkSize = NNI_ARENA_ALIGNUP(chunkSize);
+    arena->chunks = NULL;
+    arena->current = NULL;
+    arena->large = NULL;
+    arena->last = NULL;
+    arena->lastOffset = 0;
+    return arena;
+}
+
+static void nni_arena_freeLarge(nn_arena *arena) {
+    while(arena->large != NULL) {
+        nni_arenaChunk *next = arena->large->next;
+        nn_dealloc(&arena->backing, arena->large, NNI_ARENA_HEADER + arena->large->size);
+        arena->large = next;
+    }
+}
+
+void nn_destroyArena(nn_arena *arena) {
+    if(arena == NULL) return;
+    nni_arena_freeLarge(arena);
+    while(arena->chunks != NULL) {
+        nni_arenaChunk *next = arena->chunks->next;
+        nn_dealloc(&arena->backing, arena->chunks, NNI_ARENA_HEADER + arena->chunkSize);
+        arena->chunks = next;
+    }
+    nn_Alloc backing = arena->backing;
+    nn_dealloc(&backing, arena, sizeof(nn_arena));
+}
+
+void nn_arena_reset(nn_arena *arena) {
+    nni_arena_freeLarge(arena);
+    for(nni_arenaChunk *c = arena->chunks; c != NULL; c = c->next) {
+        c->used = 0;
+    }
+    arena->current = arena->chunks;
+    arena->last = NULL;
+    arena->lastOffset = 0;
+}
+
+nn_Alloc nn_arena_allocator(nn_arena *arena) {
+    return (nn_Alloc) {
+        .userdata = arena,
+        .proc = nni_arenaProc,
+    };
+}
+
+nn_Alloc *nn_arena_getBacking(nn_arena *arena) {
+    return &arena->backing;
+}
+
+nn_bool_t nn_isArenaAllocator(nn_Alloc *alloc) {
+    return alloc->proc == nni_arenaProc;
+}
+
 #ifndef NN_BAREMETAL
 
 #include <stdlib.h>
@@ -312,6 +456,24 @@ nn_bool_t nn_strbegin(const char *s, const char *prefix) {
     }
 }
 
+unsigned int nn_strhash(const char *s) {
+    unsigned int hash = 2166136261u;
+    for(nn_size_t i = 0; s[i] != 0; i++) {
+        hash ^= (unsigned char)s[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+unsigned int nn_memhash(const char *s, nn_size_t len) {
+    unsigned int hash = 2166136261u;
+    for(nn_size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)s[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
 nn_bool_t nn_error_isEmpty(nn_errorbuf_t buf) {
     if(buf == NULL) return true;
     return buf[0] == 0;
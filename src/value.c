@@ -20,20 +20,60 @@ nn_value nn_values_cstring(const char *string) {
     return (nn_value) {.tag = NN_VALUE_CSTR, .cstring = string};
 }
 
+// Empty and 1 byte strings (mostly single characters) are shared instead of allocated.
+// Same layout as nn_string, but with a fixed size so they can be static.
+typedef struct nni_staticString {
+    nn_size_t len;
+    nn_size_t refc;
+    nn_Alloc alloc;
+    char data[2];
+} nni_staticString;
+
+_Static_assert(__builtin_offsetof(nni_staticString, data) == __builtin_offsetof(nn_string, data), "static strings must look like nn_string");
+
+#define NNI_STR1(c) {.len = 1, .refc = 1, .alloc = {NULL, NULL}, .data = {(char)(c), '\0'}}
+#define NNI_STR4(c) NNI_STR1(c), NNI_STR1((c)+1), NNI_STR1((c)+2), NNI_STR1((c)+3)
+#define NNI_STR16(c) NNI_STR4(c), NNI_STR4((c)+4), NNI_STR4((c)+8), NNI_STR4((c)+12)
+#define NNI_STR64(c) NNI_STR16(c), NNI_STR16((c)+16), NNI_STR16((c)+32), NNI_STR16((c)+48)
+
+static nni_staticString nni_charStrings[256] = {
+    NNI_STR64(0), NNI_STR64(64), NNI_STR64(128), NNI_STR64(192),
+};
+
+static nni_staticString nni_emptyString = {.len = 0, .refc = 1, .alloc = {NULL, NULL}, .data = {'\0', '\0'}};
+
+static nn_bool_t nni_isStaticString(nn_string *s) {
+    return s->alloc.proc == NULL;
+}
+
 nn_value nn_values_string(nn_Alloc *alloc, const char *string, nn_size_t len) {
-    char *buf = nn_alloc(alloc, len+1);
-    if(buf == NULL) {
+    if(len == 0) {
+        return (nn_value) {.tag = NN_VALUE_STR, .string = (nn_string *)&nni_emptyString};
+    }
+    if(len == 1) {
+        return (nn_value) {.tag = NN_VALUE_STR, .string = (nn_string *)&nni_charStrings[(unsigned char)string[0]]};
+    }
+
+    nn_string *s = nn_alloc(alloc, sizeof(nn_string) + len + 1);
+    if(s == NULL) {
         return nn_values_nil();
     }
-    nn_memcpy(buf, string, len);
-    buf[len] = '\0';
+    nn_memcpy(s->data, string, len);
+    s->data[len] = '\0';
+    s->len = len;
+    s->refc = 1;
+    s->alloc = *alloc;
+
+    return (nn_value) {.tag = NN_VALUE_STR, .string = s};
+}
 
-    nn_string *s = nn_alloc(alloc, sizeof(nn_string));
+nn_value nn_values_stringBuffer(nn_Alloc *alloc, nn_size_t len) {
+    // never a static one, the caller is about to write into it
+    nn_string *s = nn_alloc(alloc, sizeof(nn_string) + len + 1);
     if(s == NULL) {
-        nn_dealloc(alloc, buf, len+1);
         return nn_values_nil();
     }
-    s->data = buf;
+    s->data[len] = '\0';
     s->len = len;
     s->refc = 1;
     s->alloc = *alloc;
@@ -41,6 +81,26 @@ nn_value nn_values_string(nn_Alloc *alloc, const char *string, nn_size_t len) {
     return (nn_value) {.tag = NN_VALUE_STR, .string = s};
 }
 
+nn_bool_t nn_values_shrinkString(nn_value *val, nn_size_t len) {
+    if(val->tag != NN_VALUE_STR) return true;
+    nn_string *s = val->string;
+    if(len >= s->len) return true;
+    nn_string *shrunk = NULL;
+    // 0 and 1 byte strings are traded in for a static one below
+    if(len > 1) shrunk = nn_resize(&s->alloc, s, sizeof(nn_string) + s->len + 1, sizeof(nn_string) + len + 1);
+    if(shrunk == NULL) {
+        // shrinking failing is very funny, but the block must be freed with the size it has, so copy it
+        nn_value copy = nn_values_string(&s->alloc, s->data, len);
+        nn_values_drop(*val);
+        *val = copy;
+        return copy.tag != NN_VALUE_NIL;
+    }
+    shrunk->len = len;
+    shrunk->data[len] = '\0';
+    val->string = shrunk;
+    return true;
+}
+
 nn_value nn_values_array(nn_Alloc *alloc, nn_size_t len) {
     nn_array *arr = nn_alloc(alloc, sizeof(nn_array));
     if(arr == NULL) {
@@ -93,8 +153,53 @@ nn_size_t nn_values_getType(nn_value val) {
     return val.tag;
 }
 
+static nn_Alloc *nni_values_arenaOf(nn_value val) {
+    nn_Alloc *alloc = NULL;
+    if(val.tag == NN_VALUE_STR) alloc = &val.string->alloc;
+    else if(val.tag == NN_VALUE_ARRAY) alloc = &val.array->alloc;
+    else if(val.tag == NN_VALUE_TABLE) alloc = &val.table->alloc;
+    if(alloc == NULL || !nn_isArenaAllocator(alloc)) return NULL;
+    return alloc;
+}
+
+// deep copy of an arena value onto the arena's backing allocator.
+// Children which already live on the heap are just retained.
+static nn_value nni_values_heapCopy(nn_value val, nn_Alloc *arenaAlloc) {
+    nn_Alloc *alloc = nn_arena_getBacking(arenaAlloc->userdata);
+    if(val.tag == NN_VALUE_STR) {
+        return nn_values_string(alloc, val.string->data, val.string->len);
+    }
+    if(val.tag == NN_VALUE_ARRAY) {
+        nn_value arr = nn_values_array(alloc, val.array->len);
+        if(arr.tag == NN_VALUE_NIL) return arr;
+        for(nn_size_t i = 0; i < val.array->len; i++) {
+            arr.array->values[i] = nn_values_retain(val.array->values[i]);
+        }
+        return arr;
+    }
+    nn_value table = nn_values_table(alloc, val.table->len);
+    if(table.tag == NN_VALUE_NIL) return table;
+    for(nn_size_t i = 0; i < val.table->len; i++) {
+        table.table->pairs[i].key = nn_values_retain(val.table->pairs[i].key);
+        table.table->pairs[i].val = nn_values_retain(val.table->pairs[i].val);
+    }
+    return table;
+}
+
+nn_value nn_values_escape(nn_value val) {
+    nn_Alloc *arena = nni_values_arenaOf(val);
+    if(arena == NULL) return val;
+    nn_value copy = nni_values_heapCopy(val, arena);
+    nn_values_drop(val);
+    return copy;
+}
+
 nn_value nn_values_retain(nn_value val) {
+    // arena values die on the next reset, so whoever keeps them gets a heap copy
+    nn_Alloc *arena = nni_values_arenaOf(val);
+    if(arena != NULL) return nni_values_heapCopy(val, arena);
     if(val.tag == NN_VALUE_STR) {
+        if(nni_isStaticString(val.string)) return val;
         val.string->refc++;
     } else if(val.tag == NN_VALUE_ARRAY) {
         val.array->refc++;
@@ -106,11 +211,10 @@ nn_value nn_values_retain(nn_value val) {
 
 void nn_values_drop(nn_value val) {
     if(val.tag == NN_VALUE_STR) {
+        if(nni_isStaticString(val.string)) return;
         val.string->refc--;
         if(val.string->refc == 0) {
-            nn_Alloc *a = &val.string->alloc;
-            nn_dealloc(a, val.string->data, val.string->len + 1);
-            nn_dealloc(a, val.string, sizeof(nn_string));
+            nn_dealloc(&val.string->alloc, val.string, sizeof(nn_string) + val.string->len + 1);
         }
     } else if(val.tag == NN_VALUE_ARRAY) {
         val.array->refc--;